@@ -1,6 +1,7 @@
 
 #include "vstl.hpp"
 #include <stdexcept>
+#include <ranges>
 
 // each test unit must contain the one begin clause
 // LENIENT means don't stop on first failed test
@@ -111,8 +112,131 @@ TEST(vstl_final) {
 
 	// mostly a demonstration that the previous
 	// test did not crash the program, (or maybe that it did)
-	// also the only test here that dosn't fail
+	// also the only test here that dosn't fail (not counting the benchmarks below)
 
 	// happy testing!
 
 };
+
+BENCH(vstl_bench) {
+
+	// a BENCH is a test that measures its block, it will be warmed up
+	// and repeated for about VSTL_BENCH_TIME milliseconds, then prints
+	// the median, min, p99 and stddev of a single iteration
+
+	std::vector<int> vec {1, 2, 3, 4, 5, 6, 7, 8};
+
+	// use do_not_optimize and clobber_memory so that
+	// the compiler can't remove the measured code
+	vstl::do_not_optimize(vec.data());
+	vstl::clobber_memory();
+
+};
+
+TEST(vstl_timeout, vstl::timeout(1000)) {
+
+	// tests can be given attributes after their name, this one will fail
+	// if it runs for longer than a second, the default timeout of all tests
+	// can be set with VSTL_TIMEOUT (in milliseconds), and vstl::timeout(0)
+	// disables it for a specific test
+
+};
+
+TEST(vstl_range) {
+
+	// whole containers and buffers can be compared at once, this is
+	// much faster than a CHECK per element, and on failure the first
+	// mismatch is reported along with the number of them
+	std::vector<int> got {1, 2, 3, 4};
+	std::vector<int> expected {1, 2, 3, 4};
+	CHECK_RANGE(got, expected);
+
+	// floating point values can be compared with a tolerance
+	std::vector<float> floats {1.0f, 2.0f};
+	float values[] {1.001f, 1.999f};
+	CHECK_NEAR_RANGE(floats, values, 0.01f);
+
+	// prints: Error: Buffers differ at 1 of 8 bytes, first at offset 4: 0x05 != 0x0a, ...
+	unsigned char frame[] {1, 2, 3, 4, 5, 6, 7, 8};
+	unsigned char golden[] {1, 2, 3, 4, 10, 6, 7, 8};
+	CHECK_BYTES(frame, golden, sizeof(frame));
+
+};
+
+// fixtures are built lazily by the first test that uses them,
+// shared by all such tests (even on many threads), and destroyed
+// after the last one of them finishes
+FIXTURE(std::vector<int>, numbers) {
+	return std::vector<int>(1000, 42);
+};
+
+TEST(vstl_fixture, vstl::uses(numbers)) {
+
+	// access the shared instance with -> or *
+	CHECK(numbers->size(), 1000);
+	CHECK((*numbers)[0], 42);
+
+};
+
+std::atomic<int> hits = 0;
+
+STRESS(vstl_stress, 4, 1000) {
+
+	// a STRESS block runs concurrently on the given number of threads, here
+	// 4 threads do 1000 iterations each, vstl::stress_yield() randomly yields
+	// with the chance set by VSTL_STRESS_YIELD to shuffle the interleavings
+	hits ++;
+	vstl::stress_yield();
+
+};
+
+TEST_ASYNC(vstl_async) {
+
+	// the block of an async test is a coroutine, all of them run
+	// together on one thread and switch at every co_await, so tests
+	// that mostly wait don't have to wait one after another
+	const auto start = std::chrono::steady_clock::now();
+	co_await vstl::sleep(10);
+	co_await vstl::yield();
+
+	// CHECK, ASSERT and FAIL work as usual
+	ASSERT(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(10));
+
+};
+
+// a parameterized test runs its block once for each of the given
+// cases, all of them run even if some fail, and big sets of cases
+// are split into batches that run on different workers
+TEST_P(vstl_cases, std::views::iota(0, 100)) (int value) {
+
+	CHECK(value * 3 / 3, value);
+
+};
+
+// a property test runs its block for values made by a generator,
+// a value it fails for is shrunk to a simpler one before reporting,
+// the seed printed with it (--seed=) reproduces the same values
+TEST_PROPERTY(vstl_property, vstl::any<std::string>()) (const std::string& text) {
+
+	CHECK(std::string(text.rbegin(), text.rend()).size(), text.size());
+
+};
+
+// a fuzz test gets arbitrary bytes, in a normal run it replays the
+// files in corpus/vstl_fuzz (see VSTL_CORPUS), and when built with
+// -fsanitize=fuzzer -DVSTL_FUZZER the same block is given to libFuzzer,
+// where any failed CHECK or ASSERT becomes a crash that keeps the input
+FUZZ(vstl_fuzz) (std::span<const uint8_t> data) {
+
+	std::string text {data.begin(), data.end()};
+	CHECK(text.size(), data.size());
+
+};
+
+// to run the tests on many threads use BEGIN_PARALLEL(mode, threads)
+// instead of BEGIN, or set the VSTL_JOBS environment variable
+// (0 means one worker per hardware thread)
+
+// the test program also accepts command line options, for example
+// `./demo 'vstl_f*' --repeat=3` runs only the tests matching the pattern,
+// three times each, see `./demo --help` for the rest of them
@@ -36,27 +36,263 @@
 #	define VSTL_TEST_COUNT 1
 #endif
 
+// number of worker threads used to execute the tests, 0 means one per hardware thread
+// can be overridden at runtime with the VSTL_JOBS environment variable
+#ifndef VSTL_JOBS
+#	define VSTL_JOBS 1
+#endif
+
+// when non-zero the tests are executed in child processes forked from the runner, this many tests per child
+// a crashing test then only takes down its own child, can be overridden with the VSTL_ISOLATE environment variable
+#ifndef VSTL_ISOLATE
+#	define VSTL_ISOLATE 0
+#endif
+
+// path of the timing database, when set the measured test durations are stored there after each run
+// and used by the next run to start the longest tests first and to balance shards by expected duration, sharded runs
+// leave the database as it is and store their durations in "<path>.<index>" for the next unsharded run to merge
+// can be overridden with the VSTL_TIMINGS environment variable
+#ifndef VSTL_TIMINGS
+#	define VSTL_TIMINGS ""
+#endif
+
+// time budget of a single BENCH in milliseconds, and the number of samples it is split into (slow benchmarks take
+// fewer samples, but at least 5), can be overridden with the VSTL_BENCH_TIME and VSTL_BENCH_SAMPLES environment variables
+#ifndef VSTL_BENCH_TIME
+#	define VSTL_BENCH_TIME 200
+#endif
+
+#ifndef VSTL_BENCH_SAMPLES
+#	define VSTL_BENCH_SAMPLES 50
+#endif
+
+// path of the benchmark baseline file, when set each BENCH is compared against its stored median and fails
+// if it got slower by more than VSTL_BENCH_THRESHOLD percent, with VSTL_BENCH_UPDATE the file is rewritten instead
+// can be overridden with the environment variables of the same names
+#ifndef VSTL_BENCH_BASELINE
+#	define VSTL_BENCH_BASELINE ""
+#endif
+
+#ifndef VSTL_BENCH_THRESHOLD
+#	define VSTL_BENCH_THRESHOLD 10
+#endif
+
+#ifndef VSTL_BENCH_UPDATE
+#	define VSTL_BENCH_UPDATE 0
+#endif
+
+// number of the slowest tests listed by the summary, and the time budget in milliseconds of a single test
+// tests that go over the budget are listed separately, can be overridden with VSTL_SLOWEST and VSTL_TIME_BUDGET
+#ifndef VSTL_SLOWEST
+#	define VSTL_SLOWEST 0
+#endif
+
+#ifndef VSTL_TIME_BUDGET
+#	define VSTL_TIME_BUDGET 0
+#endif
+
+// default timeout of a single test in milliseconds, 0 means no timeout, can be changed per test with vstl::timeout
+// a test that runs past it is failed and abandoned (or killed when isolated), can be overridden with VSTL_TIMEOUT
+#ifndef VSTL_TIMEOUT
+#	define VSTL_TIMEOUT 0
+#endif
+
+// paths of the machine readable reports, JUnit XML and JSON lines, both are streamed as the tests complete
+// can be overridden with the VSTL_JUNIT and VSTL_JSON environment variables
+#ifndef VSTL_JUNIT
+#	define VSTL_JUNIT ""
+#endif
+
+#ifndef VSTL_JSON
+#	define VSTL_JSON ""
+#endif
+
+// path of the file that keeps the outcome of each test from the last run, used by VSTL_FAILED_FIRST to start with
+// the tests that failed last time (and those that did not run yet), VSTL_FAIL_FAST stops on the first failure
+// like VSTL_MODE_STRICT, can be overridden with the environment variables of the same names
+#ifndef VSTL_STATE
+#	define VSTL_STATE ""
+#endif
+
+// path of the Chrome trace event file (open it in Perfetto or chrome://tracing) with the timeline of the run, one span
+// per test, fixture setup and benchmark phase on the track of the thread (or child process) that ran it, can
+// be overridden with the VSTL_TRACE environment variable
+#ifndef VSTL_TRACE
+#	define VSTL_TRACE ""
+#endif
+
+#ifndef VSTL_FAILED_FIRST
+#	define VSTL_FAILED_FIRST 0
+#endif
+
+#ifndef VSTL_FAIL_FAST
+#	define VSTL_FAIL_FAST 0
+#endif
+
+// number of times a failed test is run again, a test that passes on one of those attempts is reported as flaky,
+// each attempt gets the whole timeout of the test, quarantined tests (a comma separated list of glob patterns) still run,
+// but their failures don't fail the run, can be overridden with the VSTL_RETRIES and VSTL_QUARANTINE environment variables
+#ifndef VSTL_RETRIES
+#	define VSTL_RETRIES 0
+#endif
+
+#ifndef VSTL_QUARANTINE
+#	define VSTL_QUARANTINE ""
+#endif
+
+// when enabled the stdout and stderr of each test is captured and printed only if the test fails, forked children
+// (see VSTL_ISOLATE) redirect their descriptors and so capture everything, otherwise only std::cout, std::cerr and
+// std::clog are captured, can be overridden with the VSTL_CAPTURE environment variable
+#ifndef VSTL_CAPTURE
+#	define VSTL_CAPTURE 0
+#endif
+
+// when enabled CHECK_SNAPSHOT rewrites the golden files that differ (or don't exist) instead of failing,
+// can be overridden with the VSTL_SNAPSHOT_UPDATE environment variable
+#ifndef VSTL_SNAPSHOT_UPDATE
+#	define VSTL_SNAPSHOT_UPDATE 0
+#endif
+
+// when enabled, the file with BEGIN also replaces the global operator new and delete to count the heap allocations made by
+// each test, which are then shown next to its result and can be checked with ASSERT_MAX_ALLOCS and ASSERT_NO_ALLOC
+#ifndef VSTL_ALLOCS
+#	define VSTL_ALLOCS 0
+#endif
+
+// when enabled the change of the resident set size, a new peak of it, the page faults and the context switches are reported
+// for each test, in threaded runs the memory is that of the whole process, so use VSTL_ISOLATE to see a test on its own,
+// the budgets of ASSERT_MAX_RSS are always checked, can be overridden with the VSTL_RESOURCES environment variable
+#ifndef VSTL_RESOURCES
+#	define VSTL_RESOURCES 0
+#endif
+
+// when enabled the cycles, instructions, cache misses and branch misses of each test and benchmark are read from the
+// hardware performance counters (only on Linux, using perf_event_open), if the counters can't be opened only the time is
+// reported, can be overridden with the VSTL_COUNTERS environment variable
+#ifndef VSTL_COUNTERS
+#	define VSTL_COUNTERS 0
+#endif
+
+// percent chance that a STRESS thread yields between iterations (and in every vstl::stress_yield() call), shuffling the
+// interleavings it runs into, can be overridden with the VSTL_STRESS_YIELD environment variable
+#ifndef VSTL_STRESS_YIELD
+#	define VSTL_STRESS_YIELD 0
+#endif
+
+// maximum number of TEST_ASYNC tests running at the same time on the event loop,
+// can be overridden with the VSTL_ASYNC_JOBS environment variable
+#ifndef VSTL_ASYNC_JOBS
+#	define VSTL_ASYNC_JOBS 64
+#endif
+
+// number of cases of a parameterized test run together as one entry of the schedule, batches of
+// the same test can run on different workers, can be overridden with the VSTL_BATCH environment variable
+#ifndef VSTL_BATCH
+#	define VSTL_BATCH 1024
+#endif
+
+// number of inputs generated for each TEST_PROPERTY, and the seed they are generated from (0 picks a new one every run),
+// can be overridden with the VSTL_PROPERTY_CASES and VSTL_SEED environment variables
+#ifndef VSTL_PROPERTY_CASES
+#	define VSTL_PROPERTY_CASES 1000
+#endif
+
+#ifndef VSTL_SEED
+#	define VSTL_SEED 0
+#endif
+
+// directory with the inputs replayed by the FUZZ tests, each one of them reads the files in the subdirectory
+// named after it, those can be written by libFuzzer itself, can be overridden with the VSTL_CORPUS environment variable
+#ifndef VSTL_CORPUS
+#	define VSTL_CORPUS "corpus"
+#endif
+
+// define VSTL_FUZZER when building with -fsanitize=fuzzer, BEGIN then exposes a FUZZ test to libFuzzer
+// instead of defining main, the VSTL_FUZZ environment variable selects the test if there is more than one
+#ifdef VSTL_FUZZER
+#	define VSTL_MAIN(...) extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) { return vstl::fuzz(data, size); }
+#else
+#	define VSTL_MAIN(...) int main(int argc, char** argv) { return vstl::run(std::cout, __VA_ARGS__); }
+#endif
+
 #ifdef VSTL_NO_COLOR
 #	define VSTL_FAILED "failed"
 #	define VSTL_SUCCESSFUL "successful"
+#	define VSTL_FLAKY "flaky"
+#	define VSTL_CANCELLED "cancelled"
 #else
 #	define VSTL_FAILED "\033[31;1mfailed\033[0m"
 #	define VSTL_SUCCESSFUL "\033[32;1msuccessful\033[0m"
+#	define VSTL_FLAKY "\033[33;1mflaky\033[0m"
+#	define VSTL_CANCELLED "\033[33;1mcancelled\033[0m"
 #endif
 
 #include <csignal>
 #include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
 #include <vector>
+#include <deque>
+#include <list>
+#include <memory>
 #include <functional>
 #include <exception>
 #include <chrono>
 #include <iostream>
 #include <sstream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cinttypes>
+#include <array>
+#include <limits>
+#include <coroutine>
+#include <utility>
+#include <new>
+#include <ranges>
+#include <string_view>
+#include <span>
+#include <filesystem>
+#include <typeinfo>
+#include <typeindex>
+
+#ifndef _WIN32
+#	include <cerrno>
+#	include <unistd.h>
+#	include <poll.h>
+#	include <sys/wait.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <sys/resource.h>
+#endif
+
+#ifdef __linux__
+#	include <linux/perf_event.h>
+#	include <sys/syscall.h>
+#endif
 
 #define VSTL_VERSION "3.1"
 
+// the Itanium C++ ABI (GCC, Clang) can tell the type of the exception being handled without rethrowing it
+#if __has_include(<cxxabi.h>)
+#	include <cxxabi.h>
+#	define VSTL_EXCEPTION_TYPE 1
+#else
+#	define VSTL_EXCEPTION_TYPE 0
+#endif
+
 // internal macros, don't use :gun:
-#define VSTL_UNEQUAL(va, vb) for(auto __vstl_a__ = (va), __vstl_b__ = (decltype(__vstl_a__)) (vb); __vstl_a__ != __vstl_b__;)
 #define VSTL_BLC ;
 #define VSTL_JOIN(prefix, suffix) prefix##suffix
 #define VSTL_CAT(prefix, suffix) VSTL_JOIN(prefix, suffix)
@@ -68,14 +304,76 @@
 #define VSTL_RETHROW catch (vstl::TestFail& fail) { throw fail; }
 #define VSTL_VTOS(value) + vstl::to_printable(value) +
 
-/// used to define a test of the given [name]: TEST(example_test) { /* the test */ }
-#define TEST(name)          VSTL_BLC  vstl::Test VSTL_UNIQUE(__vstl_test__) = #name+[] ()
+// replacement allocation functions can't be inline, so they are only defined along with main by BEGIN
+#if VSTL_ALLOCS
+#	define VSTL_ALLOC_HOOKS \
+		static const bool __vstl_alloc_hooks__ = (vstl::allocation_hooks = true); \
+		void* operator new(size_t size) { return vstl::hooked_new(size, false); } \
+		void* operator new[](size_t size) { return vstl::hooked_new(size, false); } \
+		void* operator new(size_t size, const std::nothrow_t&) noexcept { return vstl::hooked_new(size, true); } \
+		void* operator new[](size_t size, const std::nothrow_t&) noexcept { return vstl::hooked_new(size, true); } \
+		void operator delete(void* pointer) noexcept { vstl::hooked_delete(pointer); } \
+		void operator delete[](void* pointer) noexcept { vstl::hooked_delete(pointer); } \
+		void operator delete(void* pointer, size_t) noexcept { vstl::hooked_delete(pointer); } \
+		void operator delete[](void* pointer, size_t) noexcept { vstl::hooked_delete(pointer); } \
+		void operator delete(void* pointer, const std::nothrow_t&) noexcept { vstl::hooked_delete(pointer); } \
+		void operator delete[](void* pointer, const std::nothrow_t&) noexcept { vstl::hooked_delete(pointer); }
+#else
+#	define VSTL_ALLOC_HOOKS
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#	define VSTL_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#	define VSTL_COLD __declspec(noinline)
+#else
+#	define VSTL_COLD
+#endif
+
+/// used to define a test of the given [name], optionally followed by attributes: TEST(example_test, vstl::timeout(100)) { /* the test */ }
+#define TEST(name, ...)     VSTL_BLC  static vstl::Test VSTL_UNIQUE(__vstl_test__) = vstl::Spec {#name __VA_OPT__(,) __VA_ARGS__}+[] ()
+
+/// used to define a benchmark of the given [name], the block is a single measured iteration: BENCH(example_bench) { /* the code */ }
+#define BENCH(name, ...)    VSTL_BLC  static vstl::Test VSTL_UNIQUE(__vstl_test__) = vstl::Benchmark {vstl::Spec {#name __VA_OPT__(,) __VA_ARGS__}}+[] ()
+
+/// used to define a test that runs its block for each of the [cases] (any sized range), every case runs even if some fail:
+/// TEST_P(example_test, std::views::iota(0, 1000)) (int value) { CHECK(value * 2 / 2, value); }
+#define TEST_P(name, cases, ...) VSTL_BLC static vstl::Test VSTL_UNIQUE(__vstl_test__) = vstl::Parameterized {vstl::Spec {#name __VA_OPT__(,) __VA_ARGS__}, [] () { return cases; }}+[]
+
+/// used to define a test that runs its block with values from the [generator], failing values are shrunk to simpler ones:
+/// TEST_PROPERTY(example_test, vstl::any<std::string>()) (const std::string& value) { CHECK(value.size(), strlen(value.c_str())); }
+#define TEST_PROPERTY(name, generator, ...) TEST_P(name, vstl::Property {generator} __VA_OPT__(,) __VA_ARGS__)
+
+/// used to define a test that gets arbitrary bytes, normally it runs with each of the inputs in its corpus directory (see VSTL_CORPUS),
+/// built with VSTL_FUZZER its block becomes the libFuzzer target: FUZZ(example_fuzz) (std::span<const uint8_t> data) { parse(data); }
+#define FUZZ(name, ...) VSTL_BLC static vstl::Test VSTL_UNIQUE(__vstl_test__) = vstl::Fuzz {vstl::Spec {#name __VA_OPT__(,) __VA_ARGS__}}+[]
+
+/// used to define a test whose block is a coroutine, many of them run at once on a single thread and interleave at each co_await:
+/// TEST_ASYNC(example_test) { co_await vstl::sleep(100); CHECK(1, 1); }
+#define TEST_ASYNC(name, ...) VSTL_BLC static vstl::Test VSTL_UNIQUE(__vstl_test__) = vstl::Async {vstl::Spec {#name __VA_OPT__(,) __VA_ARGS__}}+[] () -> vstl::Task
+
+/// used to define a test whose block runs [iterations] times on each of the [threads] (0 means one per hardware thread), all started together
+/// use vstl::stress_index() to tell the threads apart: STRESS(example_stress, 8, 10000) { queue.push(vstl::stress_index()); }
+#define STRESS(name, threads, iterations, ...) VSTL_BLC static vstl::Test VSTL_UNIQUE(__vstl_test__) = vstl::Stress<(threads), (iterations)> {vstl::Spec {#name __VA_OPT__(,) __VA_ARGS__}}+[] ()
 
 /// used as a starting point for the VSTL, place anywhere in the test file, preferebly at the end: BEGIN(VSTL_MODE_LENIENT)
-#define BEGIN(mode)         VSTL_BLC  int main() { return vstl::run(std::cout, mode); }
+/// the resulting program accepts command line options, run it with --help to see them
+/// tests can be spread over many source files that all include this header, but BEGIN must appear in exactly one of them
+#define BEGIN(mode)         VSTL_BLC  VSTL_ALLOC_HOOKS VSTL_MAIN(mode, argc, argv)
+
+/// same as BEGIN but executes the tests on the given number of [threads], 0 means one per hardware thread: BEGIN_PARALLEL(VSTL_MODE_LENIENT, 8)
+#define BEGIN_PARALLEL(mode, threads) VSTL_BLC  VSTL_ALLOC_HOOKS VSTL_MAIN(mode, argc, argv, threads)
 
 /// used to defined error handlers (converters), place anywhere in the test file. use like this: HANDLER { CATCH_PTR (my_error_class& err) { FAIL(err.str())  } }
-#define HANDLER             VSTL_BLC  vstl::Handler VSTL_UNIQUE(__vstl_handler__) = "handler"+[] (std::exception_ptr ptr)
+#define HANDLER             VSTL_BLC  static vstl::Handler VSTL_UNIQUE(__vstl_handler__) = "handler"+[] (std::exception_ptr ptr)
+
+/// used to define a fixture of the given [type] shared by the tests that use it, the block builds it the first time one of them runs,
+/// and it is destroyed after the last one: FIXTURE(Dataset, dataset) { return Dataset {"data.bin"}; }; TEST(example_test, vstl::uses(dataset))
+#define FIXTURE(type, name) VSTL_BLC  inline vstl::Fixture<type> name = vstl::FixtureOf<type> {#name}+[] () -> type
+
+/// used to define an error handler (converter) for exceptions of the given [type], the caught exception is called 'error'
+/// this is much faster than HANDLER when a lot of exceptions are thrown: HANDLER_FOR(my_error_class) { FAIL(error.str()) }
+#define HANDLER_FOR(type)   VSTL_BLC  static vstl::Handler VSTL_UNIQUE(__vstl_handler__) = vstl::HandlerFor<type> {}+[] (const type& error)
 
 /// helper used in defining error handlers
 #define CATCH_PTR                     try { if(ptr) std::rethrow_exception(ptr); } catch
@@ -87,14 +385,36 @@
 #define ASSERT_MSG(condition, reason) if(!(condition)) FAIL(reason)
 
 /// asserts the [condition] is true, otherwise failes the test
-#define ASSERT(condition)             ASSERT_MSG(condition, "Expected " #condition " to be true, but it was not")
+#define ASSERT(condition)             if(!(condition)) vstl::assert_failed("Expected " #condition " to be true, but it was not, " VSTL_LINE "!");
 
 /// checks if the [va] equals [vb], otherwise failes the test
-#define CHECK(va, vb)                 VSTL_UNEQUAL(va, vb) FAIL("Expected " VSTL_VTOS(__vstl_a__) " to be equal " VSTL_VTOS(__vstl_b__) ", " #va " != " #vb)
+#define CHECK(va, vb)                 vstl::check(va, vb, #va " != " #vb ", " VSTL_LINE "!");
+
+/// checks if the ranges [ra] and [rb] hold equal elements, on failure reports the first mismatch and the number of them
+#define CHECK_RANGE(ra, rb)           vstl::check_range(ra, rb, #ra " != " #rb ", " VSTL_LINE "!");
+
+/// checks if the elements of ranges [ra] and [rb] differ by no more than the given [tolerance], NaNs never match
+#define CHECK_NEAR_RANGE(ra, rb, tolerance) vstl::check_near_range(ra, rb, tolerance, #ra " != " #rb ", " VSTL_LINE "!");
+
+/// checks if the [size] bytes at [pa] and [pb] are equal, on failure reports the first differing offset and the number of them
+#define CHECK_BYTES(pa, pb, size)     vstl::check_bytes(pa, pb, size, #pa " != " #pb ", " VSTL_LINE "!");
+
+/// checks if the contents of the golden file at [path] equal the given [data] (a string or a contiguous range),
+/// when snapshots are being updated (see --update-snapshots) the file is rewritten instead
+#define CHECK_SNAPSHOT(path, data)    vstl::check_snapshot(path, data, #data ", " VSTL_LINE "!");
 
 /// checks if the given block [...] throws an exception, otherwise failes the test
 #define EXPECT_ANY(...)               try { __VA_ARGS__; FAIL(VSTL_EXCEPT); } VSTL_RETHROW catch (...) {}
 
+/// checks that the given block [...] makes at most [count] heap allocations on the calling thread, requires VSTL_ALLOCS
+#define ASSERT_MAX_ALLOCS(count, ...) { const vstl::Allocations __vstl_allocs__ = vstl::allocations; __VA_ARGS__; vstl::check_allocs(__vstl_allocs__, count, VSTL_LINE "!"); }
+
+/// checks that the given block [...] makes no heap allocations on the calling thread, requires VSTL_ALLOCS
+#define ASSERT_NO_ALLOC(...)          ASSERT_MAX_ALLOCS(0, __VA_ARGS__)
+
+/// checks that the resident set of the process grows by at most [bytes] while the given block [...] runs (Linux only)
+#define ASSERT_MAX_RSS(bytes, ...)    { const vstl::Resources __vstl_resources__ = vstl::sample_resources(); __VA_ARGS__; vstl::check_rss(__vstl_resources__, bytes, VSTL_LINE "!"); }
+
 /// checks if the given block [...] throws an exception of the given [type], otherwise failes the test
 #define EXPECT(type, ...)             try{ __VA_ARGS__; FAIL(VSTL_EXCEPT); } VSTL_RETHROW catch (type& t) {} catch (...) { FAIL("Expected exception of type " #type); }
 
@@ -144,194 +464,4771 @@ namespace vstl {
 
 	struct Test;
 	struct Handler;
+	struct FixtureBase;
+	struct Task;
 
-	std::vector<Test> tests;
-	std::vector<Handler> handlers;
-	size_t test_id = 0, failed = 0, successful = 0;
-	jmp_buf jmp;
+	/// per-thread execution state, each thread of the runner owns exactly one
+	struct Worker {
+		size_t test_id = 0;
+		size_t failed = 0, successful = 0;
+		double elapsed = 0;
+		std::string note;
+		jmp_buf jmp;
+		void* fault = nullptr;
 
-	/// add new test
-	void add_test(const Test& test) {
-		tests.push_back(test);
-	}
+		// slot of the queue this worker takes tests from, and the steady clock
+		// deadline (in nanoseconds) of the running test, 0 if it has none or once it was settled
+		size_t slot = 0;
+		std::atomic<int64_t> deadline = 0;
 
-	/// add new error handler
-	void add_handler(const Handler& handler) {
-		handlers.push_back(handler);
-	}
+		// start of the running test, read by the watchdog when it abandons the worker
+		std::atomic<std::chrono::steady_clock::time_point> started;
 
-	struct TestFail final : public std::runtime_error {
+		// set once the result of the running test was reported, by whoever got there first,
+		// a worker that lost it to the watchdog is abandoned and must stop as soon as it can
+		std::atomic<bool> settled = false;
+		std::atomic<bool> abandoned = false;
 
-		explicit TestFail(const std::string& error)
-		: runtime_error(error) {}
+		// set by a benchmark that already reported its own (per iteration) counters
+		bool counted = false;
+
+		// tests that passed only after a retry, quarantined tests that failed, and tests cut short by a stopped run,
+		// none of them is in [failed] or [successful]
+		size_t flaky = 0, quarantined = 0, cancelled = 0;
+
+		// set when the running test was cut short by a stopped run
+		bool cancelling = false;
+
+		// track of the trace this worker's thread records its tests on
+		uint64_t track = 0;
 
+		// captured output of the running test
+		std::string output;
 	};
 
-	struct Handler final {
+	/// heap allocations made by a single thread, counted by the hooks compiled in with VSTL_ALLOCS
+	struct Allocations {
+		size_t count = 0;
+		size_t bytes = 0;
 
-		using Func = std::function<void(std::exception_ptr)>;
+		// bytes allocated minus bytes freed, can go negative if the thread frees what others allocated
+		int64_t live = 0;
 
-		const Func func;
+		// allocations made while this is false are neither counted now nor when they are freed
+		bool tracking = true;
+	};
 
-		Handler(const Func& func)
-		: func(func) {
-			vstl::add_handler(*this);
+	inline thread_local Allocations allocations;
+	inline bool allocation_hooks = false;
+
+	/// stops counting the allocations of the current thread for as long as it exists
+	struct AllocationPause {
+		const bool tracking = allocations.tracking;
+
+		AllocationPause() {
+			allocations.tracking = false;
 		}
 
-		void call(std::exception_ptr ptr) const {
-			func(ptr);
+		~AllocationPause() {
+			allocations.tracking = tracking;
 		}
+	};
 
+	/// every hooked allocation is prefixed with its size, so that delete knows how much is freed
+	struct AllocationHeader {
+		size_t size;
+		bool counted;
 	};
 
-	struct Test final {
+	constexpr size_t allocation_header = std::max(sizeof(AllocationHeader), (size_t) __STDCPP_DEFAULT_NEW_ALIGNMENT__);
 
-		using Func = std::function<void(void)>;
+	inline void* hooked_new(size_t size, bool nothrow) {
+		void* block;
 
-		const char* name;
-		const Func func;
+		while ((block = std::malloc(size + allocation_header)) == nullptr) {
+			std::new_handler handler = std::get_new_handler();
 
-		Test(const char* name, const Func& func)
-		: name(name), func(func) {
-			vstl::add_test(*this);
-		}
+			if (handler == nullptr) {
+				if (nothrow) {
+					return nullptr;
+				}
 
-		void call(const size_t count) const {
-			for (size_t i = 0; i < count; i ++) {
-				func();
+				throw std::bad_alloc {};
 			}
+
+			handler();
 		}
 
-		bool run(std::ostream& out) const throw() {
-			try {
-				call(VSTL_TEST_COUNT);
+		Allocations& local = allocations;
+		new (block) AllocationHeader {size, local.tracking};
 
-			} catch (vstl::TestFail& fail) {
-				out << "Test '" << this->name << "' " VSTL_FAILED "! Error: " << fail.what() << std::endl;
-				vstl::failed ++;
-				return false;
+		if (local.tracking) {
+			local.count ++;
+			local.bytes += size;
+			local.live += size;
+		}
 
-			} catch (...) {
-				std::exception_ptr ptr = std::current_exception();
+		return static_cast<char*>(block) + allocation_header;
+	}
 
-				// try to convert the error using the defined error handlers
-				for (const Handler& handler : vstl::handlers) {
-					try {
-						handler.call(ptr);
-					} catch(vstl::TestFail& fail) {
-						out << "Test '" << this->name << "' " VSTL_FAILED "! Error: " << fail.what() << std::endl;
-						vstl::failed ++;
-						return false;
-					} catch (...) {
-						// ignore
+	inline void hooked_delete(void* pointer) {
+		if (pointer == nullptr) {
+			return;
+		}
+
+		void* block = static_cast<char*>(pointer) - allocation_header;
+		const AllocationHeader* header = static_cast<AllocationHeader*>(block);
+
+		if (header->counted) {
+			allocations.live -= header->size;
+		}
+
+		std::free(block);
+	}
+
+	/// hardware event counts, or the difference between two readings of them
+	struct CounterValues {
+		uint64_t cycles = 0;
+		uint64_t instructions = 0;
+		uint64_t cache_misses = 0;
+		uint64_t branch_misses = 0;
+
+		CounterValues operator -(const CounterValues& other) const {
+			return {cycles - other.cycles, instructions - other.instructions, cache_misses - other.cache_misses, branch_misses - other.branch_misses};
+		}
+
+		CounterValues& operator +=(const CounterValues& other) {
+			cycles += other.cycles;
+			instructions += other.instructions;
+			cache_misses += other.cache_misses;
+			branch_misses += other.branch_misses;
+			return *this;
+		}
+	};
+
+	/// hardware performance counters of the calling thread, opened as one group so that all of them count the same code
+	struct PerfCounters {
+		int fds[4] = {-1, -1, -1, -1};
+		bool available = false;
+
+		PerfCounters() {
+			#ifdef __linux__
+				const uint64_t events[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+				for (int i = 0; i < 4; i ++) {
+					perf_event_attr attr {};
+					attr.type = PERF_TYPE_HARDWARE;
+					attr.size = sizeof(attr);
+					attr.config = events[i];
+					attr.exclude_kernel = 1;
+					attr.exclude_hv = 1;
+					attr.read_format = PERF_FORMAT_GROUP;
+
+					// the group leader is the cycles counter, the rest are scheduled along with it
+					fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], PERF_FLAG_FD_CLOEXEC);
+
+					if (fds[i] == -1) {
+						return;
 					}
 				}
 
-				// everything has failed us, just try to print some reason
-				try {
-					out << "Test '" << this->name << "' " VSTL_FAILED "! Unregistered exception thrown! ";
-					std::rethrow_exception(ptr);
-				} catch (std::exception& err) {
-					out << "Error: " << err.what() << std::endl;
-				} catch (const char* err) {
-					out << "Error: " << err << std::endl;
-				} catch (int err) {
-					out << "Error: (int) " << err << std::endl;
-				}  catch (...) {
-					out << "Error: unknown" << std::endl;
+				available = true;
+			#endif
+		}
+
+		PerfCounters(const PerfCounters&) = delete;
+		PerfCounters& operator =(const PerfCounters&) = delete;
+
+		~PerfCounters() {
+			#ifdef __linux__
+				for (int fd : fds) {
+					if (fd != -1) {
+						close(fd);
+					}
 				}
+			#endif
+		}
 
-				vstl::failed ++;
-				return false;
-			}
+		/// reads the current values of all counters, returns false if they are not available
+		bool read(CounterValues& values) const {
+			#ifdef __linux__
+				struct {
+					uint64_t count;
+					uint64_t values[4];
+				} group;
 
-			out << "Test '" << this->name << "' " VSTL_SUCCESSFUL "!" << std::endl;
-			vstl::successful ++;
-			return true;
+				if (!available || ::read(fds[0], &group, sizeof(group)) != (ssize_t) sizeof(group) || group.count != 4) {
+					return false;
+				}
+
+				values = {group.values[0], group.values[1], group.values[2], group.values[3]};
+				return true;
+			#else
+				return false;
+			#endif
 		}
+	};
+
+	/// counters of the calling thread, opened when first needed
+	inline PerfCounters& perf_counters() {
+		thread_local PerfCounters counters;
+		return counters;
+	}
+
+	/// settings of a single run, taken from the compile time defaults, then the environment, then the command line
+	struct Config {
+		size_t jobs = VSTL_JOBS;
+		size_t isolate = VSTL_ISOLATE;
+		size_t shard_index = 0;
+		size_t shard_count = 1;
+		std::string timings = VSTL_TIMINGS;
+		size_t bench_time = VSTL_BENCH_TIME;
+		size_t bench_samples = VSTL_BENCH_SAMPLES;
+		std::string bench_baseline = VSTL_BENCH_BASELINE;
+		size_t bench_threshold = VSTL_BENCH_THRESHOLD;
+		bool bench_update = VSTL_BENCH_UPDATE;
+		size_t slowest = VSTL_SLOWEST;
+		size_t time_budget = VSTL_TIME_BUDGET;
+		size_t timeout = VSTL_TIMEOUT;
+		std::string junit = VSTL_JUNIT;
+		std::string json = VSTL_JSON;
+		std::string state = VSTL_STATE;
+		std::string trace = VSTL_TRACE;
+		bool failed_first = VSTL_FAILED_FIRST;
+		bool fail_fast = VSTL_FAIL_FAST;
+		bool snapshot_update = VSTL_SNAPSHOT_UPDATE;
+		bool counters = VSTL_COUNTERS;
+		bool resources = VSTL_RESOURCES;
+		size_t async_jobs = VSTL_ASYNC_JOBS;
+		size_t batch = VSTL_BATCH;
+		size_t property_cases = VSTL_PROPERTY_CASES;
+		uint64_t seed = VSTL_SEED;
+		std::string corpus = VSTL_CORPUS;
+		size_t stress_yield = VSTL_STRESS_YIELD;
+		size_t retries = VSTL_RETRIES;
+		bool capture = VSTL_CAPTURE;
+		std::vector<std::string> quarantine;
+		std::vector<std::string> filters;
+		size_t repeat = 1;
+		bool list = false;
+		bool help = false;
+	};
+
+	/// outcome of a single executed test, as seen by the reporters
+	struct Result {
+		const char* name;
+		bool passed;
+		std::string error;
+		std::string note;
+		double millis;
+
+		// a test that passed after failing has more than one attempt, its [error] is the reason of the first failure,
+		// a quarantined test can still fail, but that doesn't count as a failure of the run
+		size_t attempts = 1;
+		bool quarantined = false;
+
+		// what the test wrote to stdout and stderr, only kept for failed tests when the output is captured
+		std::string output;
+
+		// the test was cut short because the run was stopped, it is reported as skipped and its time isn't recorded
+		bool cancelled = false;
+	};
+
+	/// totals of the whole run, as seen by the reporters
+	struct Summary {
+		size_t failed, successful, flaky, quarantined, cancelled;
+		double millis;
+		const Config& config;
+	};
+
+	/// receives the events of a run, the runner never calls a reporter from more than one thread at a time
+	struct Reporter {
+
+		virtual ~Reporter() = default;
+
+		/// called right before the test of the given [name] starts
+		virtual void start(const char* name) {}
+
+		/// called once the test passed
+		virtual void pass(const Result& result) {}
+
+		/// called once the test failed
+		virtual void fail(const Result& result) {}
+
+		/// called at the very end of the run
+		virtual void finish(const Summary& summary) {}
+
+	};
 
+	/// reference result of a benchmark, as stored in the baseline file
+	struct Baseline {
+		double median = 0, mad = 0;
+		size_t samples = 0;
 	};
 
-	void summary(std::ostream& out, const auto& time) {
-		size_t executed = vstl::failed + vstl::successful;
-		double millis = std::chrono::duration<double, std::milli>(time).count();
+	inline std::vector<const Test*> tests;
+	inline size_t failed = 0, successful = 0, flaky = 0, quarantined = 0, cancellations = 0;
+	inline std::vector<bool> in_quarantine;
+	inline std::vector<double> durations, expected;
+	inline Config settings;
+	inline std::map<std::string, Baseline> baselines, recorded;
+	inline std::mutex recording;
+	inline thread_local Worker* worker = nullptr;
+	inline std::atomic<bool> stop = false;
+	inline std::vector<Reporter*> reporters, listeners;
+	inline std::mutex output;
+
+	/// reads an unsigned integer from the given environment variable, returns [fallback] if it is not set
+	inline size_t env_size(const char* name, size_t fallback) {
+		const char* value = std::getenv(name);
+
+		if (value == nullptr || *value == 0) {
+			return fallback;
+		}
 
-		out << std::endl << "Executed " << executed << " ";
-		out << (executed == 1 ? "test" : "tests") << ", ";
-		out << vstl::failed << " failed, ";
-		out << vstl::successful << " succeeded.";
-		out << " (time: " << millis << "ms)";
-		out << std::endl;
+		return std::strtoull(value, nullptr, 10);
 	}
 
-	#ifdef _WIN32
-	void signal_handler(int sig) {
-		printf("Test '%s' " VSTL_FAILED "! Error: Received SIGSEGV!", tests[test_id].name);
-		siglongjmp(vstl::jmp, 1);
+	/// reads a string from the given environment variable, returns [fallback] if it is not set
+	inline std::string env_string(const char* name, const std::string& fallback) {
+		const char* value = std::getenv(name);
+		return value == nullptr ? fallback : value;
 	}
-	#else
-	void signal_handler(int sig, siginfo_t* si, void* unused) {
-		printf("Test '%s' " VSTL_FAILED "! Error: Received SIGSEGV while trying to access: 0x%lx!\n", tests[test_id].name, (long) si->si_addr);
-		siglongjmp(vstl::jmp, 1);
+
+	/// milliseconds elapsed since the given time point
+	inline double millis_since(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 	}
-	#endif
 
-	int run(std::ostream& out, TestMode mode) {
+	/// formats a duration given in nanoseconds using the most fitting unit
+	inline std::string format_nanos(double nanos) {
+		const char* units[] = {"ns", "us", "ms", "s"};
+		size_t unit = 0;
 
-		#ifdef _WIN32
-			signal(SIGSEGV, signal_handler)
-		#else
-			struct sigaction action;
-			action.sa_flags = SA_SIGINFO;
-			sigemptyset(&action.sa_mask);
-			action.sa_sigaction = signal_handler;
+		while (std::abs(nanos) >= 1000 && unit < 3) {
+			nanos /= 1000;
+			unit ++;
+		}
 
-			if (sigaction(SIGSEGV, &action, NULL) == -1) {
-				out << "WARN: Failed to setup SIGSEGV handler!";
-				out << std::endl;
+		std::stringstream ss;
+		ss << std::setprecision(3) << nanos << units[unit];
+		return ss.str();
+	}
+
+	inline std::string format_bytes(double bytes) {
+		const char* units[] = {"B", "KiB", "MiB", "GiB"};
+		size_t unit = 0;
+
+		while (std::abs(bytes) >= 1024 && unit < 3) {
+			bytes /= 1024;
+			unit ++;
+		}
+
+		// values between 1000 and 1024 of a unit need a fourth digit to not turn into the scientific notation
+		std::stringstream ss;
+		ss << std::setprecision(std::abs(bytes) >= 1000 ? 4 : 3) << bytes << units[unit];
+		return ss.str();
+	}
+
+	inline std::string format_count(double count) {
+		const char* units[] = {"", "k", "M", "G"};
+		size_t unit = 0;
+
+		while (std::abs(count) >= 1000 && unit < 3) {
+			count /= 1000;
+			unit ++;
+		}
+
+		std::stringstream ss;
+		ss << std::setprecision(3) << count << units[unit];
+		return ss.str();
+	}
+
+	/// memory and scheduling statistics of the process, and of the calling thread where the system can tell them apart
+	struct Resources {
+		int64_t rss = 0;
+		int64_t peak = 0;
+		int64_t minor_faults = 0, major_faults = 0;
+		int64_t voluntary = 0, involuntary = 0;
+	};
+
+	/// current resident set size of the process in bytes, 0 if it can't be read
+	inline int64_t resident_size() {
+		#ifdef __linux__
+			long pages = 0, resident = 0;
+			FILE* file = fopen("/proc/self/statm", "r");
+
+			if (file == nullptr) {
+				return 0;
 			}
+
+			const bool read = fscanf(file, "%ld %ld", &pages, &resident) == 2;
+			fclose(file);
+			return read ? resident * sysconf(_SC_PAGESIZE) : 0;
+		#else
+			return 0;
 		#endif
+	}
 
-		const auto start = std::chrono::steady_clock::now();
+	/// takes the current resource usage, the faults and context switches are those of the calling thread on Linux
+	inline Resources sample_resources() {
+		Resources resources;
 
-		for (const Test& test : tests) {
-			if (sigsetjmp(jmp, 1)) {
-				failed ++;
-				goto skip;
-			}
+		#ifndef _WIN32
+			struct rusage usage;
 
-			if (!test.run(out) && mode == VSTL_MODE_STRICT) {
-				break;
+			// the peak is only known for the whole process, and it is given in kilobytes everywhere but on macOS
+			if (getrusage(RUSAGE_SELF, &usage) == 0) {
+				#ifdef __APPLE__
+				resources.peak = usage.ru_maxrss;
+				#else
+				resources.peak = usage.ru_maxrss * 1024;
+				#endif
 			}
 
-			skip:
-			test_id ++;
+			#ifdef RUSAGE_THREAD
+			getrusage(RUSAGE_THREAD, &usage);
+			#endif
+
+			resources.minor_faults = usage.ru_minflt;
+			resources.major_faults = usage.ru_majflt;
+			resources.voluntary = usage.ru_nvcsw;
+			resources.involuntary = usage.ru_nivcsw;
+			resources.rss = resident_size();
+		#endif
+
+		return resources;
+	}
+
+	/// how much the resident set grew since [before], a new peak of the process is the best estimate of how high it got,
+	/// a peak that stayed below an earlier one can't be seen, then the growth is taken from the current size
+	inline int64_t resident_growth(const Resources& before, const Resources& after) {
+		return after.peak > before.peak ? after.peak - before.rss : after.rss - before.rss;
+	}
+
+	/// formats the change of resource usage between the two samples
+	inline std::string format_resources(const Resources& before, const Resources& after) {
+		const int64_t growth = after.rss - before.rss;
+		std::stringstream ss;
+
+		ss << "rss: " << (growth >= 0 ? "+" : "") << format_bytes(growth);
+
+		if (after.peak > before.peak) {
+			ss << ", peak: " << format_bytes(after.peak) << " (+" << format_bytes(after.peak - before.peak) << ")";
 		}
 
-		summary(out, std::chrono::steady_clock::now() - start);
+		ss << ", faults: " << (after.minor_faults - before.minor_faults) + (after.major_faults - before.major_faults);
 
-		#ifdef VSTL_RETURN_ZERO
-		return 0;
-		#endif
+		if (after.major_faults > before.major_faults) {
+			ss << " (" << after.major_faults - before.major_faults << " major)";
+		}
 
-		#ifdef VSTL_RETURN_BOOL
-		return vstl::failed != 0 ? 1 : 0;
-		#endif
+		ss << ", switches: " << (after.voluntary - before.voluntary) + (after.involuntary - before.involuntary);
 
-		return vstl::failed;
+		if (after.involuntary > before.involuntary) {
+			ss << " (" << after.involuntary - before.involuntary << " involuntary)";
+		}
+
+		return ss.str();
 	}
 
-	template<typename S>
-	void fail(const S& message) {
-		throw TestFail {message};
+	/// formats the given counter values, divided by the number of [iterations] they were collected over
+	inline std::string format_counters(const CounterValues& values, size_t iterations = 1) {
+		const double divisor = std::max((size_t) 1, iterations);
+		const char* suffix = iterations > 1 ? "/iter" : "";
+		std::stringstream ss;
+
+		ss << "IPC: " << std::setprecision(3) << (values.cycles ? (double) values.instructions / values.cycles : 0.0);
+		ss << ", cycles" << suffix << ": " << format_count(values.cycles / divisor);
+		ss << ", cache misses" << suffix << ": " << format_count(values.cache_misses / divisor);
+		ss << ", branch misses" << suffix << ": " << format_count(values.branch_misses / divisor);
+		return ss.str();
 	}
 
-}
+	/// add new reporter, it will receive the events of every following run
+	inline void add_reporter(Reporter& reporter) {
+		listeners.push_back(&reporter);
+	}
 
-vstl::Test operator +(const char* name, const vstl::Test::Func& tester) {
-    return vstl::Test {name, tester};
+	/// notifies the reporters that a test started, safe to call from many workers at once
+	inline void report_start(const char* name) {
+		std::lock_guard guard {output};
+
+		for (Reporter* reporter : reporters) {
+			reporter->start(name);
+		}
+	}
+
+	/// hands the result of a test to the reporters, safe to call from many workers at once
+	inline void report(const Result& result) {
+		std::lock_guard guard {output};
+
+		for (Reporter* reporter : reporters) {
+			result.passed ? reporter->pass(result) : reporter->fail(result);
+		}
+	}
+
+	/// counts the outcome of the test at [index] into the totals of [local], returns false if it fails the run
+	inline bool tally(Worker& local, size_t index, bool passed, size_t attempts = 1, bool cancelled = false) {
+		if (passed) {
+			(attempts > 1 ? local.flaky : local.successful) ++;
+			return true;
+		}
+
+		// the failure that stopped the run was already counted
+		if (cancelled) {
+			local.cancelled ++;
+			return true;
+		}
+
+		if (in_quarantine[index]) {
+			local.quarantined ++;
+			return true;
+		}
+
+		local.failed ++;
+		return false;
+	}
+
+	/// adds the totals of a finished worker to those of the whole run
+	inline void merge(const Worker& local) {
+		vstl::failed += local.failed;
+		vstl::successful += local.successful;
+		vstl::flaky += local.flaky;
+		vstl::quarantined += local.quarantined;
+		vstl::cancellations += local.cancelled;
+	}
+
+	/// intrusive list of registered objects, linked through their own [next] pointer so that
+	/// registration during static initialization neither allocates nor depends on initialization order
+	template <typename T>
+	struct Registry {
+		T* first = nullptr;
+		T** last = &first;
+
+		void add(T& entry) {
+			*last = &entry;
+			last = &entry.next;
+		}
+	};
+
+	inline Registry<Test> registered_tests;
+	inline Registry<Handler> registered_handlers;
+	inline Registry<Handler> typed_handlers;
+	inline Registry<FixtureBase> registered_fixtures;
+
+	// typed handler chosen for each exception type seen so far, nullptr if none of them accepts it
+	inline std::map<std::type_index, const Handler*> dispatch;
+	inline std::mutex dispatching;
+
+	struct TestFail final : public std::runtime_error {
+
+		explicit TestFail(const std::string& error)
+		: runtime_error(error) {}
+
+	};
+
+	/// thrown out of a test that was cut short because the run is being stopped
+	struct TestCancelled final : public std::runtime_error {
+
+		explicit TestCancelled(const std::string& error)
+		: runtime_error(error) {}
+
+	};
+
+	struct Handler final {
+
+		using Func = void (*)(std::exception_ptr);
+		using Matcher = bool (*)(std::exception_ptr);
+
+		const Func func;
+		const Matcher matches = nullptr;
+		Handler* next = nullptr;
+
+		Handler(Func func)
+		: func(func) {
+			vstl::registered_handlers.add(*this);
+		}
+
+		/// typed handler, [matches] checks if the handler accepts the given exception
+		Handler(Matcher matches, Func func)
+		: func(func), matches(matches) {
+			vstl::typed_handlers.add(*this);
+		}
+
+		Handler(const Handler&) = delete;
+		Handler& operator =(const Handler&) = delete;
+
+		void call(std::exception_ptr ptr) const {
+			func(ptr);
+		}
+
+	};
+
+	/// marks the exception type accepted by a handler defined with HANDLER_FOR
+	template <typename T>
+	struct HandlerFor {};
+
+	template <typename T>
+	bool handles(std::exception_ptr ptr) {
+		try {
+			std::rethrow_exception(ptr);
+		} catch (const T&) {
+			return true;
+		} catch (...) {
+			return false;
+		}
+	}
+
+	/// finds the typed handler for the exception that is currently being handled, an exception type is resolved
+	/// by trying the handlers one by one only when it is first seen, after that it takes a single lookup
+	inline const Handler* typed_handler(std::exception_ptr ptr) {
+		#if VSTL_EXCEPTION_TYPE
+			const std::type_info* type = abi::__cxa_current_exception_type();
+
+			if (type != nullptr) {
+				std::lock_guard guard {dispatching};
+				auto it = dispatch.find(*type);
+
+				if (it != dispatch.end()) {
+					return it->second;
+				}
+			}
+		#endif
+
+		const Handler* found = nullptr;
+
+		for (const Handler* handler = typed_handlers.first; handler != nullptr; handler = handler->next) {
+			if (handler->matches(ptr)) {
+				found = handler;
+				break;
+			}
+		}
+
+		#if VSTL_EXCEPTION_TYPE
+			if (type != nullptr) {
+				std::lock_guard guard {dispatching};
+				dispatch.emplace(*type, found);
+			}
+		#endif
+
+		return found;
+	}
+
+	/// single event of the run timeline, with the times in steady clock nanoseconds, [thread] is the track it is drawn on
+	/// and [phase] a Chrome trace event phase, 'X' for a span on that track or 'b' for one overlapping others (async tests)
+	struct TraceEvent {
+		const char* name;
+		const char* category;
+		char phase;
+		bool passed;
+		int64_t start, duration;
+		uint64_t thread;
+	};
+
+	/// events recorded by a single thread, only that thread and (once) the end of the run touch the buffer, so its lock is never
+	/// contended, the buffers outlive their threads, so that even the events of an abandoned worker make it into the trace
+	struct TraceBuffer {
+		std::vector<TraceEvent> events;
+		std::mutex lock;
+		uint64_t thread;
+	};
+
+	inline bool tracing = false;
+	inline std::deque<TraceBuffer> trace_buffers;
+	inline std::mutex trace_lock;
+
+	inline TraceBuffer& trace_buffer() {
+		static thread_local TraceBuffer* buffer = nullptr;
+
+		if (buffer == nullptr) [[unlikely]] {
+			std::lock_guard guard {trace_lock};
+			buffer = &trace_buffers.emplace_back();
+			buffer->thread = trace_buffers.size();
+		}
+
+		return *buffer;
+	}
+
+	inline int64_t trace_clock() {
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+	}
+
+	/// records a span that started at [start] and ends now, on the track of this thread unless a [thread] is given
+	inline void trace(const char* category, const char* name, int64_t start, bool passed = true, uint64_t thread = 0, char phase = 'X') {
+		TraceBuffer& buffer = trace_buffer();
+		std::lock_guard guard {buffer.lock};
+		buffer.events.push_back({name, category, phase, passed, start, trace_clock() - start, thread == 0 ? buffer.thread : thread});
+	}
+
+	/// records the span between its construction and destruction, if tracing is enabled
+	struct TraceSpan {
+		const char* category;
+		const char* name;
+		const int64_t start;
+
+		TraceSpan(const char* category, const char* name)
+		: category(category), name(name), start(tracing ? trace_clock() : 0) {}
+
+		~TraceSpan() {
+			if (tracing) {
+				trace(category, name, start);
+			}
+		}
+	};
+
+	/// type independent part of a fixture, as seen by the runner
+	struct FixtureBase {
+		const char* name;
+		FixtureBase* next = nullptr;
+
+		// number of the scheduled tests that use this fixture and didn't finish yet
+		std::atomic<size_t> users = 0;
+
+		explicit FixtureBase(const char* name)
+		: name(name) {
+			vstl::registered_fixtures.add(*this);
+		}
+
+		FixtureBase(const FixtureBase&) = delete;
+		FixtureBase& operator =(const FixtureBase&) = delete;
+
+		/// destroys the shared instance, if it was built
+		virtual void release() = 0;
+	};
+
+	/// a lazily built instance of [T], shared by all the tests that use it
+	template <typename T>
+	struct Fixture final : FixtureBase {
+
+		using Builder = T (*)();
+
+		const Builder builder;
+		std::atomic<T*> value = nullptr;
+		std::mutex lock;
+
+		Fixture(const char* name, Builder builder)
+		: FixtureBase(name), builder(builder) {}
+
+		~Fixture() {
+			release();
+		}
+
+		/// returns the shared instance, the first caller builds it while the others wait,
+		/// if building it throws the test fails and the next user tries again
+		T& get() {
+			T* current = value.load(std::memory_order_acquire);
+
+			if (current == nullptr) [[unlikely]] {
+				std::lock_guard guard {lock};
+				current = value.load(std::memory_order_relaxed);
+
+				if (current == nullptr) {
+					// the fixture outlives the test that happened to build it, so it's not that test's allocation
+					AllocationPause pause;
+					TraceSpan span {"fixture", name};
+					current = new T(builder());
+					value.store(current, std::memory_order_release);
+				}
+			}
+
+			return *current;
+		}
+
+		T& operator *() {
+			return get();
+		}
+
+		T* operator ->() {
+			return &get();
+		}
+
+		void release() override {
+			std::lock_guard guard {lock};
+			delete value.exchange(nullptr);
+		}
+	};
+
+	template <typename T>
+	struct FixtureOf {
+		const char* name;
+	};
+
+	/// marks one use of each of the [fixtures] as finished, releasing those that have no users left
+	inline void finish_fixtures(const std::array<FixtureBase*, 4>& fixtures) {
+		for (FixtureBase* fixture : fixtures) {
+			if (fixture != nullptr && fixture->users.fetch_sub(1) == 1) {
+				fixture->release();
+			}
+		}
+	}
+
+	/// releases all the fixtures that are still alive
+	inline void release_fixtures() {
+		for (FixtureBase* fixture = registered_fixtures.first; fixture != nullptr; fixture = fixture->next) {
+			fixture->release();
+		}
+	}
+
+	/// name of a test along with its optional attributes, as given to the TEST macro
+	struct Spec {
+		const char* name;
+		long timeout = -1;
+		std::array<FixtureBase*, 4> fixtures {};
+
+		template <typename... Attributes>
+		Spec(const char* name, const Attributes&... attributes)
+		: name(name) {
+			(attributes.apply(*this), ...);
+		}
+	};
+
+	/// test attribute that overrides the default timeout, in milliseconds
+	struct Timeout {
+		long millis;
+
+		void apply(Spec& spec) const {
+			spec.timeout = millis;
+		}
+	};
+
+	/// sets the timeout of a test to the given number of milliseconds, 0 disables it: TEST(example_test, vstl::timeout(500))
+	inline Timeout timeout(long millis) {
+		return {millis};
+	}
+
+	/// test attribute that lists the fixtures used by a test, so that they can be released after their last user
+	struct Uses {
+		std::array<FixtureBase*, 4> fixtures;
+
+		void apply(Spec& spec) const {
+			auto slot = std::find(spec.fixtures.begin(), spec.fixtures.end(), nullptr);
+
+			for (FixtureBase* fixture : fixtures) {
+				if (fixture != nullptr && slot != spec.fixtures.end()) {
+					*slot ++ = fixture;
+				}
+			}
+		}
+	};
+
+	/// declares that a test uses the given fixtures (at most four per test): TEST(example_test, vstl::uses(dataset, server))
+	template <typename... Fixtures>
+	Uses uses(Fixtures&... fixtures) {
+		static_assert(sizeof...(Fixtures) <= 4, "A test can use at most four fixtures");
+		return {{&fixtures...}};
+	}
+
+	/// writes the reason of the exception that is currently being handled (other than TestFail) into [error]
+	inline void describe_exception(std::ostream& error) {
+		std::exception_ptr ptr = std::current_exception();
+
+		// typed handlers take precedence, as they need just one rethrow to convert the error
+		if (const Handler* handler = typed_handler(ptr)) {
+			try {
+				handler->call(ptr);
+			} catch(vstl::TestFail& fail) {
+				error << "Error: " << fail.what();
+				return;
+			} catch (...) {
+				// ignore
+			}
+		}
+
+		// try to convert the error using the defined error handlers
+		for (const Handler* handler = vstl::registered_handlers.first; handler != nullptr; handler = handler->next) {
+			try {
+				handler->call(ptr);
+			} catch(vstl::TestFail& fail) {
+				error << "Error: " << fail.what();
+				return;
+			} catch (...) {
+				// ignore
+			}
+		}
+
+		// everything has failed us, just try to print some reason
+		try {
+			error << "Unregistered exception thrown! ";
+			std::rethrow_exception(ptr);
+		} catch (std::exception& err) {
+			error << "Error: " << err.what();
+		} catch (const char* err) {
+			error << "Error: " << err;
+		} catch (int err) {
+			error << "Error: (int) " << err;
+		}  catch (...) {
+			error << "Error: unknown";
+		}
+	}
+
+	// output of the test running on this thread is appended here while it is being captured
+	inline thread_local std::string* captured = nullptr;
+
+	/// file the stdout and stderr of a forked child are redirected to during each test, along with the original
+	/// descriptors they are restored to afterwards, all -1 outside of the children
+	struct Redirect {
+		int file = -1;
+		int out = -1, err = -1;
+	};
+
+	inline Redirect redirect;
+
+	/// replaces the buffer of a standard stream, keeps the output of the threads that capture it and passes the rest through
+	struct CaptureBuffer final : public std::streambuf {
+
+		std::streambuf* original;
+
+		explicit CaptureBuffer(std::streambuf* original)
+		: original(original) {}
+
+		int overflow(int c) override {
+			if (c == traits_type::eof()) {
+				return traits_type::not_eof(c);
+			}
+
+			if (captured) {
+				captured->push_back((char) c);
+				return c;
+			}
+
+			return original->sputc((char) c);
+		}
+
+		std::streamsize xsputn(const char* data, std::streamsize size) override {
+			if (captured) {
+				captured->append(data, size);
+				return size;
+			}
+
+			return original->sputn(data, size);
+		}
+
+		int sync() override {
+			return captured ? 0 : original->pubsync();
+		}
+
+	};
+
+	/// starts capturing the output of the test running on this thread into [output]
+	inline void begin_capture(std::string& output) {
+		output.clear();
+
+		if (!settings.capture) {
+			return;
+		}
+
+		// the output of a child goes through its descriptors, which catches printf (and anything it runs) as well
+		#ifndef _WIN32
+		if (redirect.file != -1) {
+			std::cout.flush();
+			std::cerr.flush();
+			fflush(stdout);
+			fflush(stderr);
+
+			// the redirected descriptors share the offset of the file, so it has to be rewound too
+			if (ftruncate(redirect.file, 0) == 0 && lseek(redirect.file, 0, SEEK_SET) == 0) {
+				dup2(redirect.file, STDOUT_FILENO);
+				dup2(redirect.file, STDERR_FILENO);
+			}
+
+			return;
+		}
+		#endif
+
+		captured = &output;
+	}
+
+	/// reads the whole capture file of a child, the runner does that too if the child dies in the middle of a test
+	inline std::string read_capture(int file) {
+		std::string output;
+
+		#ifndef _WIN32
+		struct stat info;
+		output.resize(fstat(file, &info) == 0 ? info.st_size : 0);
+
+		if (pread(file, output.data(), output.size(), 0) != (ssize_t) output.size()) {
+			output.clear();
+		}
+		#endif
+
+		return output;
+	}
+
+	/// stops capturing the output of this thread, [output] then holds everything the test wrote
+	inline void end_capture(std::string& output) {
+		captured = nullptr;
+
+		#ifndef _WIN32
+		if (redirect.file != -1 && settings.capture) {
+			std::cout.flush();
+			std::cerr.flush();
+			fflush(stdout);
+			fflush(stderr);
+
+			dup2(redirect.out, STDOUT_FILENO);
+			dup2(redirect.err, STDERR_FILENO);
+			output = read_capture(redirect.file);
+		}
+		#endif
+	}
+
+	struct Test final {
+
+		using Func = void (*)();
+		using Coroutine = Task (*)();
+
+		const char* name;
+		const Func func;
+		const long timeout = -1;
+		const std::array<FixtureBase*, 4> fixtures {};
+
+		// body of an async test, they also have a [func] that runs it on a loop of its own
+		const Coroutine coroutine = nullptr;
+
+		// number of cases of a parameterized test, such a test is split into batches of them before the run,
+		// each batch points back to its [parent] and covers the cases from [first] up to (not including) [last]
+		using Cases = size_t (*)();
+
+		const Cases cases = nullptr;
+		const Test* parent = nullptr;
+		const size_t first = 0, last = 0;
+
+		// body of a fuzz test, called with each input by the [func] of the test or by libFuzzer
+		using Fuzzer = void (*)(std::span<const uint8_t>);
+
+		const Fuzzer fuzzer = nullptr;
+		Test* next = nullptr;
+
+		Test(const char* name, Func func)
+		: name(name), func(func) {
+			vstl::registered_tests.add(*this);
+		}
+
+		Test(const Spec& spec, Func func)
+		: name(spec.name), func(func), timeout(spec.timeout), fixtures(spec.fixtures) {
+			vstl::registered_tests.add(*this);
+		}
+
+		Test(const Spec& spec, Func func, Cases cases)
+		: name(spec.name), func(func), timeout(spec.timeout), fixtures(spec.fixtures), cases(cases) {
+			vstl::registered_tests.add(*this);
+		}
+
+		/// a batch of the cases of the given [parent], these are created by the runner and not registered
+		Test(const Test& parent, const char* name, size_t first, size_t last)
+		: name(name), func(parent.func), timeout(parent.timeout), fixtures(parent.fixtures), parent(&parent), first(first), last(last) {}
+
+		Test(const Spec& spec, Func func, Fuzzer fuzzer)
+		: name(spec.name), func(func), timeout(spec.timeout), fixtures(spec.fixtures), fuzzer(fuzzer) {
+			vstl::registered_tests.add(*this);
+		}
+
+		Test(const Spec& spec, Func func, Coroutine coroutine)
+		: name(spec.name), func(func), timeout(spec.timeout), fixtures(spec.fixtures), coroutine(coroutine) {
+			vstl::registered_tests.add(*this);
+		}
+
+		Test(const Test&) = delete;
+		Test& operator =(const Test&) = delete;
+
+		void call(const size_t count) const {
+			for (size_t i = 0; i < count; i ++) {
+				func();
+			}
+		}
+
+		/// runs the test, on failure writes the reason into [error] and returns false
+		bool execute(std::ostream& error) const {
+			try {
+				call(VSTL_TEST_COUNT);
+				return true;
+
+			} catch (vstl::TestFail& fail) {
+				AllocationPause pause;
+				error << "Error: " << fail.what();
+				return false;
+
+			} catch (vstl::TestCancelled& cancel) {
+				AllocationPause pause;
+				error << "Error: " << cancel.what();
+				vstl::worker->cancelling = true;
+				return false;
+
+			} catch (...) {
+				// describing the failure is not part of the test
+				AllocationPause pause;
+				describe_exception(error);
+				return false;
+			}
+		}
+
+		/// runs the test (again, up to the configured number of retries, for as long as it fails) and reports it,
+		/// returns false if the test failed in a way that fails the whole run
+		bool run() const throw() {
+			std::stringstream error, retried;
+			CounterValues first, last;
+			Allocations before, after;
+			Resources usage_before, usage_after;
+			bool counting, passed;
+			size_t attempts = 0;
+
+			const int64_t traced_at = tracing ? trace_clock() : 0;
+			begin_capture(vstl::worker->output);
+
+			// only the last attempt is measured, the error of the first failure is kept for the flaky report
+			do {
+				if (attempts ++ == 1) {
+					retried << error.str();
+				}
+
+				// every attempt gets the whole timeout, reporting the start again also restarts the clock of an isolated test
+				if (attempts > 1) {
+					const long timeout = this->timeout >= 0 ? this->timeout : (long) settings.timeout;
+					const auto now = std::chrono::steady_clock::now();
+
+					vstl::worker->started = now;
+					vstl::worker->deadline = timeout <= 0 ? 0 : (now + std::chrono::milliseconds(timeout)).time_since_epoch().count();
+					report_start(this->name);
+				}
+
+				error.str("");
+				vstl::worker->note.clear();
+				vstl::worker->cancelling = false;
+				counting = settings.counters && perf_counters().read(first);
+				vstl::worker->counted = false;
+
+				if (settings.resources) {
+					usage_before = sample_resources();
+				}
+
+				before = allocations;
+				const auto start = std::chrono::steady_clock::now();
+				passed = execute(error);
+
+				vstl::worker->elapsed = millis_since(start);
+				after = allocations;
+
+				if (settings.resources) {
+					usage_after = sample_resources();
+				}
+			} while (!passed && attempts <= settings.retries && !vstl::worker->settled && !stop);
+
+			end_capture(vstl::worker->output);
+			finish_fixtures(fixtures);
+
+			if (counting && !vstl::worker->counted && perf_counters().read(last)) {
+				std::string& note = vstl::worker->note;
+				note += (note.empty() ? "" : ", ") + format_counters(last - first);
+			}
+
+			if (allocation_hooks && after.count != before.count) {
+				std::string& note = vstl::worker->note;
+				note += note.empty() ? "" : ", ";
+				note += "allocs: " + std::to_string(after.count - before.count) + " (" + format_bytes(after.bytes - before.bytes) + ")";
+
+				if (after.live > before.live) {
+					note += ", leaked: " + format_bytes(after.live - before.live);
+				}
+			}
+
+			if (settings.resources) {
+				std::string& note = vstl::worker->note;
+				note += (note.empty() ? "" : ", ") + format_resources(usage_before, usage_after);
+			}
+
+			// the watchdog might have already reported this test as timed out
+			const bool abandoned = vstl::worker->settled.exchange(true);
+			vstl::worker->deadline = 0;
+
+			if (abandoned) {
+				vstl::worker->abandoned = true;
+				return false;
+			}
+
+			const size_t index = vstl::worker->test_id;
+			const std::string reason = passed && attempts > 1 ? retried.str() : error.str();
+
+			if (tracing) {
+				trace("test", this->name, traced_at, passed);
+			}
+
+			const bool cancelled = vstl::worker->cancelling;
+			vstl::report({this->name, passed, reason, vstl::worker->note, vstl::worker->elapsed, attempts, !passed && !cancelled && in_quarantine[index], passed ? "" : vstl::worker->output, cancelled});
+			return tally(*vstl::worker, index, passed, attempts, cancelled);
+		}
+
+	};
+
+	/// freezes the registered tests into the indexable table used by the runner
+	inline void collect() {
+		tests.clear();
+
+		for (const Test* test = registered_tests.first; test != nullptr; test = test->next) {
+			tests.push_back(test);
+		}
+	}
+
+	/// hands the result of the failed test at [index] to the reporters
+	inline void report_failure(size_t index, const std::string& error, double millis, const std::string& output = "") {
+		report({tests[index]->name, false, error, "", millis, 1, in_quarantine[index], output});
+	}
+
+	inline std::deque<Test> batches;
+	inline std::deque<std::string> batch_names;
+
+	/// splits every parameterized test into batches of its cases, each taking its own place in the tests table
+	inline void expand() {
+		std::vector<const Test*> expanded;
+		batches.clear();
+		batch_names.clear();
+
+		for (const Test* test : tests) {
+			if (test->cases == nullptr) {
+				expanded.push_back(test);
+				continue;
+			}
+
+			const size_t count = test->cases();
+			const size_t size = std::max((size_t) 1, settings.batch);
+			size_t first = 0;
+
+			// a test with a single batch keeps its name
+			do {
+				const size_t last = std::min(count, first + size);
+				const char* name = test->name;
+
+				if (count > size) {
+					batch_names.push_back(std::string {test->name} + "[" + std::to_string(first) + ".." + std::to_string(last) + ")");
+					name = batch_names.back().c_str();
+				}
+
+				batches.emplace_back(*test, name, first, last);
+				expanded.push_back(&batches.back());
+				first = last;
+			} while (first < count);
+		}
+
+		tests = std::move(expanded);
+	}
+
+	/// default human readable reporter, buffers the passed tests and only flushes on failures, every second and at the end
+	struct ConsoleReporter final : public Reporter {
+
+		std::ostream& out;
+		std::string buffer;
+		std::chrono::steady_clock::time_point flushed = std::chrono::steady_clock::now();
+
+		ConsoleReporter(std::ostream& out)
+		: out(out) {}
+
+		void line(const Result& result) {
+			std::stringstream line;
+			line << "Test '" << result.name << "' ";
+
+			if (result.attempts > 1 && result.passed) {
+				line << VSTL_FLAKY "! " << result.error << " (passed on attempt " << result.attempts << ")";
+			} else if (result.passed) {
+				line << VSTL_SUCCESSFUL "!";
+			} else if (result.cancelled) {
+				line << VSTL_CANCELLED "!";
+			} else {
+				line << VSTL_FAILED << (result.quarantined ? " (quarantined)! " : "! ") << result.error;
+			}
+
+			line << " (time: " << format_nanos(result.millis * 1e6) << ")";
+
+			if (!result.note.empty()) {
+				line << " (" << result.note << ")";
+			}
+
+			buffer += line.str();
+			buffer += '\n';
+
+			// the captured output follows the line of the failed test it belongs to
+			if (!result.output.empty()) {
+				buffer += result.output;
+				buffer += result.output.back() == '\n' ? "" : "\n";
+			}
+		}
+
+		void flush() {
+			out << buffer;
+			out.flush();
+			buffer.clear();
+			flushed = std::chrono::steady_clock::now();
+		}
+
+		void pass(const Result& result) override {
+			line(result);
+
+			if (buffer.size() > 64 * 1024 || millis_since(flushed) > 1000) {
+				flush();
+			}
+		}
+
+		void fail(const Result& result) override {
+			line(result);
+			flush();
+		}
+
+		void finish(const Summary& summary) override {
+			const Config& config = summary.config;
+			size_t executed = summary.failed + summary.successful + summary.flaky + summary.quarantined + summary.cancelled;
+
+			out << buffer;
+			buffer.clear();
+
+			out << std::endl << "Executed " << executed << " ";
+			out << (executed == 1 ? "test" : "tests") << ", ";
+			out << summary.failed << " failed, ";
+
+			if (summary.flaky > 0) {
+				out << summary.flaky << " flaky, ";
+			}
+
+			if (summary.quarantined > 0) {
+				out << summary.quarantined << " quarantined, ";
+			}
+
+			if (summary.cancelled > 0) {
+				out << summary.cancelled << " cancelled, ";
+			}
+
+			out << summary.successful << " succeeded.";
+			out << " (time: " << summary.millis << "ms)";
+
+			if (config.shard_count > 1) {
+				out << " (shard: " << config.shard_index << "/" << config.shard_count << ")";
+			}
+
+			out << std::endl;
+
+			std::vector<size_t> executed_tests;
+
+			for (size_t i = 0; i < tests.size(); i ++) {
+				if (durations[i] >= 0) {
+					executed_tests.push_back(i);
+				}
+			}
+
+			std::stable_sort(executed_tests.begin(), executed_tests.end(), [] (size_t a, size_t b) {
+				return durations[a] > durations[b];
+			});
+
+			if (config.slowest > 0 && !executed_tests.empty()) {
+				out << "Slowest tests:" << std::endl;
+
+				for (size_t i = 0; i < std::min(config.slowest, executed_tests.size()); i ++) {
+					out << " - '" << tests[executed_tests[i]]->name << "' " << format_nanos(durations[executed_tests[i]] * 1e6) << std::endl;
+				}
+			}
+
+			if (config.time_budget > 0 && !executed_tests.empty() && durations[executed_tests.front()] > config.time_budget) {
+				out << "Tests over the time budget of " << config.time_budget << "ms:" << std::endl;
+
+				for (size_t index : executed_tests) {
+					if (durations[index] > config.time_budget) {
+						out << " - '" << tests[index]->name << "' " << format_nanos(durations[index] * 1e6) << std::endl;
+					}
+				}
+			}
+		}
+
+	};
+
+	/// strips the "Error: " prefix the runner puts before every failure reason
+	inline std::string failure_message(const std::string& error) {
+		return error.starts_with("Error: ") ? error.substr(7) : error;
+	}
+
+	/// length of the valid UTF-8 sequence starting at [offset] in [text], 0 if the bytes there are not one,
+	/// overlong encodings, surrogates and code points above U+10FFFF are all rejected
+	inline size_t utf8_length(const std::string& text, size_t offset) {
+		const unsigned char lead = text[offset];
+		size_t length;
+		unsigned char low = 0x80, high = 0xBF;
+
+		if (lead < 0x80) {
+			return 1;
+		}
+
+		if (lead >= 0xC2 && lead <= 0xDF) {
+			length = 2;
+		} else if (lead >= 0xE0 && lead <= 0xEF) {
+			length = 3;
+			low = lead == 0xE0 ? 0xA0 : 0x80;
+			high = lead == 0xED ? 0x9F : 0xBF;
+		} else if (lead >= 0xF0 && lead <= 0xF4) {
+			length = 4;
+			low = lead == 0xF0 ? 0x90 : 0x80;
+			high = lead == 0xF4 ? 0x8F : 0xBF;
+		} else {
+			return 0;
+		}
+
+		if (offset + length > text.size()) {
+			return 0;
+		}
+
+		// only the second byte has a narrower range, the rest are plain continuation bytes
+		for (size_t i = 1; i < length; i ++) {
+			const unsigned char next = text[offset + i];
+
+			if (next < (i == 1 ? low : 0x80) || next > (i == 1 ? high : 0xBF)) {
+				return 0;
+			}
+		}
+
+		return length;
+	}
+
+	/// escapes the text for use inside of XML attributes and elements, bytes that are not valid UTF-8 are replaced
+	inline std::string escape_xml(const std::string& text) {
+		std::string escaped;
+
+		for (size_t i = 0; i < text.size(); i ++) {
+			const char c = text[i];
+
+			if ((unsigned char) c >= 0x80) {
+				const size_t length = utf8_length(text, i);
+
+				// U+FFFE and U+FFFF are not allowed in XML, even when they are encoded correctly
+				if (length == 0 || text.compare(i, 3, "\xEF\xBF\xBE") == 0 || text.compare(i, 3, "\xEF\xBF\xBF") == 0) {
+					escaped += "&#xFFFD;";
+					continue;
+				}
+
+				escaped.append(text, i, length);
+				i += length - 1;
+				continue;
+			}
+
+			switch (c) {
+				case '&': escaped += "&amp;"; break;
+				case '<': escaped += "&lt;"; break;
+				case '>': escaped += "&gt;"; break;
+				case '"': escaped += "&quot;"; break;
+				case '\'': escaped += "&apos;"; break;
+				default:
+					if ((unsigned char) c >= 0x20 || c == '\n' || c == '\t') {
+						escaped += c;
+					}
+			}
+		}
+
+		return escaped;
+	}
+
+	/// escapes the text for use inside of a JSON string, bytes that are not valid UTF-8 are replaced
+	inline std::string escape_json(const std::string& text) {
+		std::string escaped;
+
+		for (size_t i = 0; i < text.size(); i ++) {
+			const char c = text[i];
+
+			if ((unsigned char) c >= 0x80) {
+				const size_t length = utf8_length(text, i);
+
+				if (length == 0) {
+					escaped += "\\ufffd";
+					continue;
+				}
+
+				escaped.append(text, i, length);
+				i += length - 1;
+				continue;
+			}
+
+			switch (c) {
+				case '"': escaped += "\\\""; break;
+				case '\\': escaped += "\\\\"; break;
+				case '\n': escaped += "\\n"; break;
+				case '\t': escaped += "\\t"; break;
+				default:
+					if ((unsigned char) c < 0x20) {
+						char code[8];
+						snprintf(code, sizeof(code), "\\u%04x", c);
+						escaped += code;
+					} else {
+						escaped += c;
+					}
+			}
+		}
+
+		return escaped;
+	}
+
+	/// base of the reporters that stream into a file, the file is flushed on failures and at least every second,
+	/// so a crashed run still leaves everything up to the last failure behind
+	struct FileReporter : public Reporter {
+
+		std::ofstream file;
+		std::chrono::steady_clock::time_point flushed = std::chrono::steady_clock::now();
+
+		FileReporter(const std::string& path)
+		: file(path) {}
+
+		void flush(bool force) {
+			if (force || millis_since(flushed) > 1000) {
+				file.flush();
+				flushed = std::chrono::steady_clock::now();
+			}
+		}
+
+	};
+
+	/// streams a JUnit XML report, the total counts are not known upfront, so they are left for the consumer to count
+	struct JUnitReporter final : public FileReporter {
+
+		JUnitReporter(const std::string& path)
+		: FileReporter(path) {
+			file << std::fixed << std::setprecision(6);
+			file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+			file << "<testsuites>\n";
+			file << "\t<testsuite name=\"vstl\">\n";
+			file.flush();
+		}
+
+		void testcase(const Result& result) {
+			file << "\t\t<testcase name=\"" << escape_xml(result.name) << "\" classname=\"vstl\" time=\"" << result.millis / 1000 << "\"";
+
+			if (result.passed && result.attempts == 1 && result.note.empty() && result.output.empty()) {
+				file << "/>\n";
+				return;
+			}
+
+			file << ">\n";
+
+			// quarantined failures are skipped, so that they don't fail the CI job either, and so are cancelled tests
+			const std::string message = escape_xml(failure_message(result.error));
+
+			if (result.passed && result.attempts > 1) {
+				file << "\t\t\t<flakyFailure message=\"" << message << "\">" << message << "</flakyFailure>\n";
+			} else if (result.cancelled) {
+				file << "\t\t\t<skipped message=\"" << message << "\"/>\n";
+			} else if (result.quarantined) {
+				file << "\t\t\t<skipped message=\"Quarantined: " << message << "\"/>\n";
+			} else if (!result.passed) {
+				file << "\t\t\t<failure message=\"" << message << "\">" << message << "</failure>\n";
+			}
+
+			if (!result.note.empty() || !result.output.empty()) {
+				const std::string separator = result.note.empty() || result.output.empty() ? "" : "\n";
+				file << "\t\t\t<system-out>" << escape_xml(result.note + separator + result.output) << "</system-out>\n";
+			}
+
+			file << "\t\t</testcase>\n";
+		}
+
+		void pass(const Result& result) override {
+			testcase(result);
+			flush(false);
+		}
+
+		void fail(const Result& result) override {
+			testcase(result);
+			flush(true);
+		}
+
+		void finish(const Summary& summary) override {
+			file << "\t</testsuite>\n";
+			file << "</testsuites>\n";
+			file.flush();
+		}
+
+	};
+
+	/// streams a JSON lines report, one object per test and a final summary object
+	struct JsonReporter final : public FileReporter {
+
+		JsonReporter(const std::string& path)
+		: FileReporter(path) {
+			file << std::fixed << std::setprecision(6);
+		}
+
+		void object(const Result& result) {
+			file << "{\"event\": \"test\", \"name\": \"" << escape_json(result.name) << "\"";
+			file << ", \"status\": \"" << (result.passed ? (result.attempts > 1 ? "flaky" : "passed") : (result.cancelled ? "cancelled" : result.quarantined ? "quarantined" : "failed")) << "\"";
+			file << ", \"time\": " << result.millis / 1000;
+
+			if (result.attempts > 1) {
+				file << ", \"attempts\": " << result.attempts;
+			}
+
+			if (!result.passed || result.attempts > 1) {
+				file << ", \"message\": \"" << escape_json(failure_message(result.error)) << "\"";
+			}
+
+			if (!result.note.empty()) {
+				file << ", \"note\": \"" << escape_json(result.note) << "\"";
+			}
+
+			if (!result.output.empty()) {
+				file << ", \"output\": \"" << escape_json(result.output) << "\"";
+			}
+
+			file << "}\n";
+		}
+
+		void pass(const Result& result) override {
+			object(result);
+			flush(false);
+		}
+
+		void fail(const Result& result) override {
+			object(result);
+			flush(true);
+		}
+
+		void finish(const Summary& summary) override {
+			file << "{\"event\": \"summary\", \"failed\": " << summary.failed << ", \"successful\": " << summary.successful;
+			file << ", \"flaky\": " << summary.flaky << ", \"quarantined\": " << summary.quarantined << ", \"cancelled\": " << summary.cancelled;
+			file << ", \"time\": " << summary.millis / 1000;
+
+			if (summary.config.shard_count > 1) {
+				file << ", \"shard\": " << summary.config.shard_index << ", \"shards\": " << summary.config.shard_count;
+			}
+
+			file << "}\n";
+			file.flush();
+		}
+
+	};
+
+	/// reads the outcomes of the last run, one "<passed|failed> <name>" entry per line
+	inline std::map<std::string, bool> load_state(const std::string& path) {
+		std::map<std::string, bool> outcomes;
+		std::ifstream file {path};
+		std::string status, name;
+
+		while (file >> status && std::getline(file >> std::ws, name)) {
+			outcomes[name] = status == "passed";
+		}
+
+		return outcomes;
+	}
+
+	/// remembers the outcome of each test and merges them into the state file at the end of the run
+	struct StateReporter final : public Reporter {
+
+		std::string path;
+		std::map<std::string, bool> outcomes;
+
+		StateReporter(const std::string& path)
+		: path(path) {}
+
+		void pass(const Result& result) override {
+
+			// a name shared by many tests counts as failed if any of them failed
+			outcomes.try_emplace(result.name, true);
+		}
+
+		void fail(const Result& result) override {
+
+			// a cancelled test never got to finish, the last outcome it had still stands
+			if (!result.cancelled) {
+				outcomes[result.name] = false;
+			}
+		}
+
+		void finish(const Summary& summary) override {
+			std::map<std::string, bool> merged = load_state(path);
+
+			for (const auto& [name, passed] : outcomes) {
+				merged[name] = passed;
+			}
+
+			const std::string temporary = path + ".tmp";
+			std::ofstream file {temporary};
+
+			for (const auto& [name, passed] : merged) {
+				file << (passed ? "passed " : "failed ") << name << "\n";
+			}
+
+			file.close();
+
+			if (!file || std::rename(temporary.c_str(), path.c_str()) != 0) {
+				std::remove(temporary.c_str());
+			}
+		}
+
+	};
+
+	/// hands the totals of the run to the reporters
+	inline void report_summary(const Summary& summary) {
+		std::lock_guard guard {output};
+
+		for (Reporter* reporter : reporters) {
+			reporter->finish(summary);
+		}
+	}
+
+	/// stable 64 bit FNV-1a hash of a string, used to assign tests to shards
+	inline uint64_t hash(const char* string) {
+		uint64_t value = 14695981039346656037ull;
+
+		for (; *string; string ++) {
+			value ^= (unsigned char) *string;
+			value *= 1099511628211ull;
+		}
+
+		return value;
+	}
+
+	/// writes the events recorded so far as a Chrome trace event file, with the times relative to [origin]
+	inline void save_trace(const std::string& path, int64_t origin) {
+		std::vector<TraceEvent> traced;
+		std::ofstream file {path};
+		size_t id = 0;
+
+		{
+			std::lock_guard guard {trace_lock};
+
+			for (TraceBuffer& buffer : trace_buffers) {
+				std::lock_guard owner {buffer.lock};
+				traced.insert(traced.end(), buffer.events.begin(), buffer.events.end());
+				buffer.events.clear();
+			}
+		}
+
+		std::stable_sort(traced.begin(), traced.end(), [] (const TraceEvent& a, const TraceEvent& b) {
+			return a.start < b.start;
+		});
+
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+		for (size_t i = 0; i < traced.size(); i ++) {
+			const TraceEvent& event = traced[i];
+			const double start = (event.start - origin) / 1e3;
+			std::stringstream common;
+
+			common << "\"name\": \"" << escape_json(event.name) << "\", \"cat\": \"" << event.category << "\", \"pid\": 1, \"tid\": " << event.thread;
+
+			if (event.phase == 'b') {
+				common << ", \"id\": " << ++ id;
+				file << "{" << common.str() << ", \"ph\": \"b\", \"ts\": " << start << ", \"args\": {\"passed\": " << (event.passed ? "true" : "false") << "}},\n";
+				file << "{" << common.str() << ", \"ph\": \"e\", \"ts\": " << start + event.duration / 1e3 << "}";
+			} else {
+				file << "{" << common.str() << ", \"ph\": \"X\", \"ts\": " << start << ", \"dur\": " << event.duration / 1e3;
+				file << ", \"args\": {\"passed\": " << (event.passed ? "true" : "false") << "}}";
+			}
+
+			file << (i + 1 < traced.size() ? ",\n" : "\n");
+		}
+
+		file << "]}\n";
+	}
+
+	/// reads the timing database, one "<milliseconds> <name>" entry per line
+	inline std::map<std::string, double> load_timings(const std::string& path) {
+		std::map<std::string, double> timings;
+		std::ifstream file {path};
+		double millis;
+		std::string name;
+
+		while (file >> millis && std::getline(file >> std::ws, name)) {
+			timings[name] = millis;
+		}
+
+		return timings;
+	}
+
+	/// merges the durations measured in this run into the timing database, tests that did not run keep their old entries
+	/// a sharded run writes only its own measurements to "<path>.<index>" instead, so that every shard of the run is
+	/// partitioned using the same database, the next run that is not sharded merges those files into the database
+	inline void save_timings(const std::string& path, const Config& config) {
+		const bool sharded = config.shard_count > 1;
+		std::map<std::string, double> timings;
+		std::map<std::string, double> measured;
+		std::vector<std::filesystem::path> merged;
+
+		if (!sharded) {
+			timings = load_timings(path);
+
+			// the measurements left behind by the shards of earlier runs
+			const std::filesystem::path database {path};
+			const std::filesystem::path directory = database.has_parent_path() ? database.parent_path() : ".";
+			const std::string prefix = database.filename().string() + ".";
+			std::error_code error;
+
+			for (const auto& entry : std::filesystem::directory_iterator {directory, error}) {
+				const std::string name = entry.path().filename().string();
+
+				if (name.size() > prefix.size() && name.starts_with(prefix) && std::all_of(name.begin() + prefix.size(), name.end(), [] (char c) { return c >= '0' && c <= '9'; })) {
+					merged.push_back(entry.path());
+				}
+			}
+
+			std::sort(merged.begin(), merged.end());
+
+			for (const auto& file : merged) {
+				for (const auto& [name, millis] : load_timings(file.string())) {
+					timings[name] = millis;
+				}
+			}
+		}
+
+		// tests sharing a name are stored as the slowest one of them
+		for (size_t i = 0; i < tests.size(); i ++) {
+			if (durations[i] >= 0) {
+				measured[tests[i]->name] = std::max(measured[tests[i]->name], durations[i]);
+			}
+		}
+
+		for (const auto& [name, millis] : measured) {
+			timings[name] = millis;
+		}
+
+		// write to a side file first, so that a crash can't leave a truncated database behind
+		const std::string target = sharded ? path + "." + std::to_string(config.shard_index) : path;
+		const std::string temporary = target + ".tmp";
+		std::ofstream file {temporary};
+
+		for (const auto& [name, millis] : timings) {
+			file << millis << " " << name << "\n";
+		}
+
+		file.close();
+
+		if (!file || std::rename(temporary.c_str(), target.c_str()) != 0) {
+			std::remove(temporary.c_str());
+			return;
+		}
+
+		for (const auto& merged_file : merged) {
+			std::remove(merged_file.c_str());
+		}
+	}
+
+	/// formats a baseline entry as a single "<median> <mad> <samples> <name>" line
+	inline std::string format_baseline(const std::string& name, const Baseline& baseline) {
+		std::stringstream line;
+		line << std::setprecision(17) << baseline.median << " " << baseline.mad << " " << baseline.samples << " " << name;
+		return line.str();
+	}
+
+	/// parses a single baseline entry line, returns false if it is malformed
+	inline bool parse_baseline(std::istream& in, std::string& name, Baseline& baseline) {
+		return in >> baseline.median >> baseline.mad >> baseline.samples && std::getline(in >> std::ws, name);
+	}
+
+	/// reads all entries of the benchmark baseline file
+	inline std::map<std::string, Baseline> load_baselines(const std::string& path) {
+		std::map<std::string, Baseline> entries;
+		std::ifstream file {path};
+		std::string name;
+		Baseline baseline;
+
+		while (parse_baseline(file, name, baseline)) {
+			entries[name] = baseline;
+		}
+
+		return entries;
+	}
+
+	/// merges the benchmark results recorded in this run into the baseline file
+	inline void save_baselines(const std::string& path) {
+		std::map<std::string, Baseline> entries = load_baselines(path);
+
+		for (const auto& [name, baseline] : recorded) {
+			entries[name] = baseline;
+		}
+
+		const std::string temporary = path + ".tmp";
+		std::ofstream file {temporary};
+
+		for (const auto& [name, baseline] : entries) {
+			file << format_baseline(name, baseline) << "\n";
+		}
+
+		file.close();
+
+		if (!file || std::rename(temporary.c_str(), path.c_str()) != 0) {
+			std::remove(temporary.c_str());
+		}
+	}
+
+	/// loads the expected duration of each test from the timing database, negative if unknown
+	inline void expect_timings(const Config& config) {
+		expected.assign(tests.size(), -1);
+		durations.assign(tests.size(), -1);
+
+		if (config.timings.empty()) {
+			return;
+		}
+
+		std::map<std::string, double> timings = load_timings(config.timings);
+
+		for (size_t i = 0; i < tests.size(); i ++) {
+			auto it = timings.find(tests[i]->name);
+
+			if (it != timings.end()) {
+				expected[i] = it->second;
+			}
+		}
+	}
+
+	/// matches the text against a glob pattern, where '*' matches any sequence and '?' any single character
+	inline bool glob(const char* pattern, const char* text) {
+		const char* star = nullptr;
+		const char* resume = nullptr;
+
+		while (*text) {
+			if (*pattern == '*') {
+				star = pattern ++;
+				resume = text;
+			} else if (*pattern == '?' || *pattern == *text) {
+				pattern ++;
+				text ++;
+			} else if (star) {
+				pattern = star + 1;
+				text = ++ resume;
+			} else {
+				return false;
+			}
+		}
+
+		while (*pattern == '*') {
+			pattern ++;
+		}
+
+		return *pattern == 0;
+	}
+
+	/// checks if the test name passes the filters, it has to match any of the patterns (if there are any) and
+	/// none of the negative patterns, those that start with a '-', the batch of a parameterized test can be matched
+	/// by its own [name] (as printed by --list) or by the name of the whole test, its [family]
+	inline bool filter(const Config& config, const char* name, const char* family = nullptr) {
+		bool positive = false, matched = false;
+
+		const auto matches = [&] (const char* pattern) {
+			return glob(pattern, name) || (family != nullptr && glob(pattern, family));
+		};
+
+		for (const std::string& pattern : config.filters) {
+			if (pattern.starts_with("-")) {
+				if (matches(pattern.c_str() + 1)) {
+					return false;
+				}
+
+				continue;
+			}
+
+			positive = true;
+			matched = matched || matches(pattern.c_str());
+		}
+
+		return matched || !positive;
+	}
+
+	/// splits the comma separated list of glob patterns and appends them to the given [patterns]
+	inline void add_patterns(std::vector<std::string>& patterns, const std::string& list) {
+		std::stringstream stream {list};
+		std::string pattern;
+
+		while (std::getline(stream, pattern, ',')) {
+			if (!pattern.empty()) {
+				patterns.push_back(pattern);
+			}
+		}
+	}
+
+	/// selects the indices of the tests that belong to the configured shard, in the declaration order
+	/// tests with a known duration are balanced between the shards, this requires all shards to see the same timing database
+	inline std::vector<size_t> select(const Config& config) {
+		std::vector<size_t> selected, timed;
+		std::vector<double> load(config.shard_count, 0);
+		std::vector<size_t> hashed(config.shard_count, 0);
+
+		for (size_t i = 0; i < tests.size(); i ++) {
+			// batches of a parameterized test are selected by the name of the whole test
+			if (!filter(config, tests[i]->name, tests[i]->parent ? tests[i]->parent->name : nullptr)) {
+				continue;
+			}
+
+			if (config.shard_count > 1 && expected[i] >= 0) {
+				timed.push_back(i);
+				continue;
+			}
+
+			const size_t shard = hash(tests[i]->name) % config.shard_count;
+			hashed[shard] ++;
+
+			if (shard == config.shard_index) {
+				selected.push_back(i);
+			}
+		}
+
+		std::sort(timed.begin(), timed.end(), [] (size_t a, size_t b) {
+			return expected[a] != expected[b] ? expected[a] > expected[b] : a < b;
+		});
+
+		// the tests placed by their hash are expected to take as long as an average timed test
+		double average = 0;
+
+		for (size_t index : timed) {
+			average += expected[index] / timed.size();
+		}
+
+		for (size_t shard = 0; shard < config.shard_count; shard ++) {
+			load[shard] = hashed[shard] * average;
+		}
+
+		// greedily place the longest remaining test on the least loaded shard
+		for (size_t index : timed) {
+			size_t shard = std::min_element(load.begin(), load.end()) - load.begin();
+			load[shard] += expected[index];
+
+			if (shard == config.shard_index) {
+				selected.push_back(index);
+			}
+		}
+
+		std::sort(selected.begin(), selected.end());
+		return selected;
+	}
+
+	/// moves the tests that failed in the last run to the front, followed by the tests that did not run yet
+	inline void prioritize(std::vector<size_t>& selected, const std::map<std::string, bool>& outcomes) {
+		std::stable_sort(selected.begin(), selected.end(), [&] (size_t a, size_t b) {
+			auto rank = [&] (size_t index) {
+				auto it = outcomes.find(tests[index]->name);
+				return it == outcomes.end() ? 1 : (it->second ? 2 : 0);
+			};
+
+			return rank(a) < rank(b);
+		});
+	}
+
+	/// orders the selected tests longest first, tests of unknown duration go before all others
+	inline void schedule(std::vector<size_t>& selected) {
+		std::stable_sort(selected.begin(), selected.end(), [] (size_t a, size_t b) {
+			double ea = expected[a] < 0 ? INFINITY : expected[a];
+			double eb = expected[b] < 0 ? INFINITY : expected[b];
+			return ea > eb;
+		});
+	}
+
+	#ifdef _WIN32
+	inline void signal_handler(int sig) {
+		if (vstl::worker == nullptr) {
+			signal(sig, SIG_DFL);
+			raise(sig);
+			return;
+		}
+
+		// the failure is reported by the worker, once it is out of the signal handler
+		vstl::worker->abandoned = vstl::worker->settled.exchange(true);
+		siglongjmp(vstl::worker->jmp, 1);
+	}
+	#else
+	inline void signal_handler(int sig, siginfo_t* si, void* unused) {
+
+		// the fault did not happen inside of a test, there is nothing to recover to
+		if (vstl::worker == nullptr) {
+			signal(sig, SIG_DFL);
+			raise(sig);
+			return;
+		}
+
+		// the failure is reported by the worker once it is out of the signal handler,
+		// unless the watchdog already reported this test, then the worker just gets out
+		vstl::worker->abandoned = vstl::worker->settled.exchange(true);
+		vstl::worker->fault = si->si_addr;
+		siglongjmp(vstl::worker->jmp, 1);
+	}
+	#endif
+
+	/// queue of tests dealt to one slot of the threaded runner, idle workers steal from its back
+	struct Queue {
+		std::deque<size_t> items;
+		std::mutex lock;
+	};
+
+	/// shared state of the threaded runner, the workers and threads lists are guarded by the lock
+	struct Pool {
+		TestMode mode;
+		std::vector<Queue> queues;
+		std::list<Worker> workers;
+		std::list<std::thread> threads;
+		std::mutex lock;
+		std::condition_variable changed;
+		size_t active = 0;
+		bool done = false;
+	};
+
+	/// effective timeout of the test at [index] in milliseconds, 0 if it has none
+	inline long timeout_of(size_t index) {
+		return tests[index]->timeout >= 0 ? tests[index]->timeout : (long) settings.timeout;
+	}
+
+	/// prepares the worker for running the test at [index]
+	inline void begin(Worker& worker, size_t index) {
+		const long timeout = timeout_of(index);
+
+		const auto started = std::chrono::steady_clock::now();
+
+		// the watchdog must never see the test unsettled while the deadline of the previous one is still there
+		worker.test_id = index;
+		worker.started = started;
+		worker.deadline = timeout <= 0 ? 0 : (started + std::chrono::milliseconds(timeout)).time_since_epoch().count();
+		worker.settled = false;
+
+		report_start(tests[index]->name);
+	}
+
+	/// takes the next test for the given [slot], once its own queue runs dry steals from the back of other queues
+	inline bool take(Pool& pool, size_t slot, size_t& index) {
+		for (size_t i = 0; i < pool.queues.size(); i ++) {
+			Queue& victim = pool.queues[(slot + i) % pool.queues.size()];
+			std::lock_guard guard {victim.lock};
+
+			if (victim.items.empty()) {
+				continue;
+			}
+
+			if (i == 0) {
+				index = victim.items.front();
+				victim.items.pop_front();
+			} else {
+				index = victim.items.back();
+				victim.items.pop_back();
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+	/// main loop of a single worker thread, executes tests until there is nothing left to take
+	inline void work(Pool& pool, Worker& local) {
+		size_t index;
+
+		vstl::worker = &local;
+		local.track = tracing ? trace_buffer().thread : 0;
+
+		while (!stop && take(pool, local.slot, index)) {
+			begin(local, index);
+
+			if (sigsetjmp(local.jmp, 1)) {
+				if (local.abandoned) {
+					break;
+				}
+
+				std::stringstream error;
+				error << "Error: Received SIGSEGV";
+
+				#ifndef _WIN32
+				error << " while trying to access: 0x" << std::hex << (uintptr_t) local.fault;
+				#endif
+
+				error << "!";
+				local.deadline = 0;
+				durations[index] = millis_since(local.started);
+				end_capture(local.output);
+
+				if (tracing) {
+					trace("test", tests[index]->name, local.started.load().time_since_epoch().count(), false);
+				}
+
+				report_failure(index, error.str(), durations[index], local.output);
+				stop = stop || (!tally(local, index, false) && pool.mode == VSTL_MODE_STRICT);
+				continue;
+			}
+
+			const bool counted = tests[index]->run();
+
+			if (local.abandoned) {
+				break;
+			}
+
+			// the time of a cancelled test says nothing about how long it takes
+			if (!local.cancelling) {
+				durations[index] = local.elapsed;
+			}
+
+			if (!counted && pool.mode == VSTL_MODE_STRICT) {
+				stop = true;
+			}
+		}
+
+		vstl::worker = nullptr;
+
+		// an abandoned worker was already replaced, nobody waits for it anymore
+		if (!local.abandoned) {
+			std::lock_guard guard {pool.lock};
+			pool.active --;
+			pool.changed.notify_all();
+		}
+	}
+
+	/// starts a new worker thread for the given queue [slot], must be called with the pool lock held
+	inline void hire(Pool& pool, size_t slot) {
+		Worker& worker = pool.workers.emplace_back();
+		worker.slot = slot;
+		pool.threads.emplace_back(work, std::ref(pool), std::ref(worker));
+	}
+
+	/// reports the test of a stuck worker as timed out and gives its queue to a fresh worker, must be called with the pool lock held
+	inline void abandon(Pool& pool, Worker& stuck) {
+		const auto started = stuck.started.load();
+		const double elapsed = millis_since(started);
+		std::stringstream error;
+
+		stuck.abandoned = true;
+		error << "Error: Timed out after " << timeout_of(stuck.test_id) << "ms!";
+
+		report_failure(stuck.test_id, error.str(), elapsed);
+		durations[stuck.test_id] = elapsed;
+
+		if (tracing) {
+			trace("test", tests[stuck.test_id]->name, started.time_since_epoch().count(), false, stuck.track);
+		}
+
+		if (!tally(stuck, stuck.test_id, false) && pool.mode == VSTL_MODE_STRICT) {
+			stop = true;
+		}
+
+		// there is no way to stop the stuck thread, so leave it be and don't wait for it
+		hire(pool, stuck.slot);
+	}
+
+	/// watchdog of the threaded runner, checks the deadlines of all running tests
+	inline void watch(Pool& pool) {
+		std::unique_lock lock {pool.lock};
+
+		while (!pool.done) {
+			const auto now = std::chrono::steady_clock::now();
+			auto wake = now + std::chrono::milliseconds(10);
+
+			for (Worker& worker : pool.workers) {
+				const int64_t deadline = worker.deadline;
+
+				if (deadline == 0 || worker.abandoned) {
+					continue;
+				}
+
+				const std::chrono::steady_clock::time_point expiry {std::chrono::steady_clock::duration(deadline)};
+
+				if (expiry > now) {
+					wake = std::min(wake, expiry);
+					continue;
+				}
+
+				// the worker could have just finished, in that case its result stands
+				if (!worker.settled.exchange(true)) {
+					abandon(pool, worker);
+				}
+			}
+
+			pool.changed.wait_until(lock, wake);
+		}
+	}
+
+	/// threaded runner, deals the selected tests out to [jobs] workers, returns false if some workers had to be abandoned
+	inline bool threaded(TestMode mode, const std::vector<size_t>& selected, size_t jobs) {
+
+		// the pool is leaked when a worker is abandoned, as its thread still uses it
+		Pool* pool = new Pool {mode, std::vector<Queue>(jobs)};
+		bool watched = settings.timeout > 0;
+
+		// deal the tests out round-robin, so that with a single worker they run in the declaration order
+		for (size_t i = 0; i < selected.size(); i ++) {
+			pool->queues[i % jobs].items.push_back(selected[i]);
+			watched = watched || tests[selected[i]]->timeout > 0;
+		}
+
+		std::thread watchdog;
+
+		{
+			std::lock_guard guard {pool->lock};
+			pool->active = jobs;
+
+			// with timeouts in use all workers need to run on their own threads, so that the calling thread is free to finish the run
+			for (size_t i = watched ? 0 : 1; i < jobs; i ++) {
+				hire(*pool, i);
+			}
+
+			if (!watched) {
+				pool->workers.emplace_front();
+			}
+		}
+
+		if (watched) {
+			watchdog = std::thread {watch, std::ref(*pool)};
+		} else {
+			work(*pool, pool->workers.front());
+		}
+
+		std::unique_lock lock {pool->lock};
+		pool->changed.wait(lock, [&] { return pool->active == 0; });
+		pool->done = true;
+		pool->changed.notify_all();
+		lock.unlock();
+
+		if (watchdog.joinable()) {
+			watchdog.join();
+		}
+
+		bool clean = true;
+		auto thread = pool->threads.begin();
+
+		for (Worker& worker : pool->workers) {
+			merge(worker);
+			clean = clean && !worker.abandoned;
+
+			// the worker running on the calling thread has no thread of its own
+			if (&worker == &pool->workers.front() && !watched) {
+				continue;
+			}
+
+			if (worker.abandoned) {
+				thread->detach();
+			} else {
+				thread->join();
+			}
+
+			thread ++;
+		}
+
+		if (clean) {
+			delete pool;
+		}
+
+		return clean;
+	}
+
+	/// body of an async test, or any coroutine it awaits, started lazily and resumed by the event loop
+	struct Task {
+
+		struct promise_type;
+		using Handle = std::coroutine_handle<promise_type>;
+
+		struct promise_type {
+			std::exception_ptr error;
+			std::coroutine_handle<> continuation;
+
+			Task get_return_object() {
+				return Task {Handle::from_promise(*this)};
+			}
+
+			std::suspend_always initial_suspend() noexcept {
+				return {};
+			}
+
+			/// once done, continue straight with whoever awaited this task (if anyone)
+			auto final_suspend() noexcept {
+				struct Final {
+					bool await_ready() noexcept { return false; }
+					void await_resume() noexcept {}
+
+					std::coroutine_handle<> await_suspend(Handle handle) noexcept {
+						std::coroutine_handle<> next = handle.promise().continuation;
+						return next ? next : std::noop_coroutine();
+					}
+				};
+
+				return Final {};
+			}
+
+			void return_void() {}
+
+			void unhandled_exception() {
+				error = std::current_exception();
+			}
+		};
+
+		Handle handle;
+
+		explicit Task(Handle handle)
+		: handle(handle) {}
+
+		Task(Task&& other) noexcept
+		: handle(std::exchange(other.handle, nullptr)) {}
+
+		Task(const Task&) = delete;
+		Task& operator =(const Task&) = delete;
+
+		~Task() {
+			if (handle) {
+				handle.destroy();
+			}
+		}
+
+		// awaiting a task runs it, the awaiter continues once it's done
+		bool await_ready() const noexcept {
+			return false;
+		}
+
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+			handle.promise().continuation = awaiter;
+			return handle;
+		}
+
+		void await_resume() const {
+			if (handle.promise().error) {
+				std::rethrow_exception(handle.promise().error);
+			}
+		}
+
+	};
+
+	/// single threaded scheduler of the suspended coroutines, every wakeup is tagged with the [owner] (running test) it belongs to
+	struct Loop {
+
+		struct Wakeup {
+			std::coroutine_handle<> handle;
+			size_t owner;
+		};
+
+		struct Timer {
+			std::chrono::steady_clock::time_point at;
+			Wakeup wakeup;
+		};
+
+		struct Watch {
+			int fd;
+			short events;
+			short* result;
+			Wakeup wakeup;
+		};
+
+		std::deque<Wakeup> ready;
+		std::vector<Timer> timers;
+		std::vector<Watch> watches;
+		size_t current = 0;
+
+		bool idle() const {
+			return ready.empty() && timers.empty() && watches.empty();
+		}
+
+		/// drops all the pending wakeups of the given [owner], before its coroutines are destroyed
+		void forget(size_t owner) {
+			std::erase_if(ready, [owner] (const Wakeup& wakeup) { return wakeup.owner == owner; });
+			std::erase_if(timers, [owner] (const Timer& timer) { return timer.wakeup.owner == owner; });
+			std::erase_if(watches, [owner] (const Watch& watch) { return watch.wakeup.owner == owner; });
+		}
+
+		/// waits until a timer is due or a watched file descriptor is ready, but no longer than until [limit]
+		void wait(std::chrono::steady_clock::time_point limit) {
+			for (const Timer& timer : timers) {
+				limit = std::min(limit, timer.at);
+			}
+
+			const auto now = std::chrono::steady_clock::now();
+			const long millis = limit <= now ? 0 : (long) std::ceil(std::chrono::duration<double, std::milli>(limit - now).count());
+
+			#ifndef _WIN32
+				std::vector<pollfd> fds;
+
+				for (const Watch& watch : watches) {
+					fds.push_back({watch.fd, watch.events, 0});
+				}
+
+				if (poll(fds.data(), fds.size(), (int) std::min(millis, (long) INT32_MAX)) > 0) {
+					for (size_t i = fds.size(); i -- > 0;) {
+						if (fds[i].revents != 0) {
+							*watches[i].result = fds[i].revents;
+							ready.push_back(watches[i].wakeup);
+							watches.erase(watches.begin() + i);
+						}
+					}
+				}
+			#else
+				std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+			#endif
+
+			const auto after = std::chrono::steady_clock::now();
+
+			std::erase_if(timers, [&] (const Timer& timer) {
+				if (timer.at <= after) {
+					ready.push_back(timer.wakeup);
+					return true;
+				}
+
+				return false;
+			});
+		}
+
+	};
+
+	inline thread_local Loop* loop = nullptr;
+
+	/// awaitable that resumes after the given [delay], use it with co_await inside of TEST_ASYNC
+	struct Sleep {
+		std::chrono::steady_clock::duration delay;
+
+		bool await_ready() const noexcept {
+			return delay <= std::chrono::steady_clock::duration::zero();
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) const {
+			loop->timers.push_back({std::chrono::steady_clock::now() + delay, {handle, loop->current}});
+		}
+
+		void await_resume() const noexcept {}
+	};
+
+	/// suspends the calling async test for the given number of milliseconds, letting the others run: co_await vstl::sleep(10)
+	inline Sleep sleep(long millis) {
+		return {std::chrono::milliseconds(millis)};
+	}
+
+	/// awaitable that lets the other ready coroutines run first
+	struct Yield {
+		bool await_ready() const noexcept {
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) const {
+			loop->ready.push_back({handle, loop->current});
+		}
+
+		void await_resume() const noexcept {}
+	};
+
+	/// suspends the calling async test until all the others that are ready had their turn: co_await vstl::yield()
+	inline Yield yield() {
+		return {};
+	}
+
+	#ifndef _WIN32
+	/// awaitable that resumes once the file descriptor is ready, results in the poll() revents
+	struct Readiness {
+		int fd;
+		short events;
+		short result = 0;
+
+		bool await_ready() const noexcept {
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) {
+			loop->watches.push_back({fd, events, &result, {handle, loop->current}});
+		}
+
+		short await_resume() const noexcept {
+			return result;
+		}
+	};
+
+	/// suspends the calling async test until [fd] is ready for the given poll() [events]: short revents = co_await vstl::ready(fd, POLLIN)
+	inline Readiness ready(int fd, short events) {
+		return {fd, events};
+	}
+	#endif
+
+	/// runs the given [task] on a loop of its own until it's done, used when an async test runs like any other test
+	inline void await(Task task) {
+		Loop local;
+		Loop* outer = std::exchange(loop, &local);
+		local.ready.push_back({task.handle, 0});
+
+		while (true) {
+			while (!local.ready.empty() && !task.handle.done()) {
+				std::coroutine_handle<> handle = local.ready.front().handle;
+				local.ready.pop_front();
+				handle.resume();
+			}
+
+			if (task.handle.done()) {
+				break;
+			}
+
+			if (local.idle()) {
+				loop = outer;
+				throw TestFail {"Async test is waiting for something that is not a vstl awaitable, and can't be resumed!"};
+			}
+
+			local.wait(std::chrono::steady_clock::time_point::max());
+		}
+
+		loop = outer;
+		task.await_resume();
+	}
+
+	/// an async test that is currently running on the loop
+	struct Running {
+		size_t owner;
+		size_t index;
+		Task task;
+		std::chrono::steady_clock::time_point started;
+		std::chrono::steady_clock::time_point deadline;
+		std::string note;
+	};
+
+	/// runs the [selected] async tests at once on the calling thread, at most [limit] of them at the same time,
+	/// a test that is suspended for longer than its timeout is destroyed and reported as timed out
+	inline void asynchronous(TestMode mode, Worker& local, const std::vector<size_t>& selected, size_t limit) {
+		Loop scheduler;
+		std::list<Running> running;
+		size_t next = 0, owners = 0;
+
+		vstl::worker = &local;
+		vstl::loop = &scheduler;
+
+		const auto settle = [&] (std::list<Running>::iterator it, bool passed, const std::string& error, bool cancelled = false) {
+			const double elapsed = millis_since(it->started);
+
+			if (!cancelled) {
+				durations[it->index] = elapsed;
+			}
+
+			scheduler.forget(it->owner);
+			finish_fixtures(tests[it->index]->fixtures);
+
+			// async tests overlap on the same thread, so each one gets a span of its own
+			if (tracing) {
+				trace("test", tests[it->index]->name, it->started.time_since_epoch().count(), passed, 0, 'b');
+			}
+
+			if (!tally(local, it->index, passed, 1, cancelled)) {
+				stop = stop || mode == VSTL_MODE_STRICT;
+			}
+
+			report({tests[it->index]->name, passed, error, it->note, elapsed, 1, !passed && !cancelled && in_quarantine[it->index], "", cancelled});
+			running.erase(it);
+		};
+
+		while ((next < selected.size() && !stop) || !running.empty()) {
+
+			// start new tests, as long as there is room for them
+			while (next < selected.size() && !stop && running.size() < std::max((size_t) 1, limit)) {
+				const size_t index = selected[next ++];
+				const long timeout = timeout_of(index);
+
+				begin(local, index);
+				const auto started = std::chrono::steady_clock::now();
+				const auto deadline = timeout <= 0 ? std::chrono::steady_clock::time_point::max() : started + std::chrono::milliseconds(timeout);
+
+				running.push_back({owners ++, index, tests[index]->coroutine(), started, deadline, ""});
+				scheduler.ready.push_back({running.back().task.handle, running.back().owner});
+			}
+
+			// resume everything that became ready, each coroutine runs until its next co_await
+			while (!scheduler.ready.empty()) {
+				const Loop::Wakeup wakeup = scheduler.ready.front();
+				scheduler.ready.pop_front();
+
+				auto it = std::find_if(running.begin(), running.end(), [&] (const Running& test) { return test.owner == wakeup.owner; });
+
+				if (it == running.end()) {
+					continue;
+				}
+
+				scheduler.current = wakeup.owner;
+				local.test_id = it->index;
+				local.note = std::move(it->note);
+				local.settled = false;
+
+				if (sigsetjmp(local.jmp, 1)) {
+					std::stringstream error;
+					error << "Error: Received SIGSEGV";
+
+					#ifndef _WIN32
+					error << " while trying to access: 0x" << std::hex << (uintptr_t) local.fault;
+					#endif
+
+					// the frames of a faulted test can't be trusted, so they are leaked instead of destroyed
+					error << "!";
+					it->note = std::move(local.note);
+					it->task.handle = nullptr;
+					settle(it, false, error.str());
+					continue;
+				}
+
+				wakeup.handle.resume();
+				it->note = std::move(local.note);
+
+				if (it->task.handle.done()) {
+					std::stringstream error;
+					bool passed = true, cancelled = false;
+
+					try {
+						it->task.await_resume();
+					} catch (vstl::TestFail& fail) {
+						error << "Error: " << fail.what();
+						passed = false;
+					} catch (vstl::TestCancelled& cancel) {
+						error << "Error: " << cancel.what();
+						passed = false;
+						cancelled = true;
+					} catch (...) {
+						describe_exception(error);
+						passed = false;
+					}
+
+					settle(it, passed, error.str(), cancelled);
+				}
+			}
+
+			if (running.empty()) {
+				continue;
+			}
+
+			// the suspended tests of a stopped run are destroyed right away, like those that time out
+			if (stop) {
+				while (!running.empty()) {
+					settle(running.begin(), false, "Error: Cancelled, the run was stopped by an earlier failure!", true);
+				}
+
+				continue;
+			}
+
+			// tests that wait on something the loop doesn't know about would never finish
+			if (scheduler.idle()) {
+				while (!running.empty()) {
+					settle(running.begin(), false, "Error: Async test is waiting for something that is not a vstl awaitable, and can't be resumed!");
+				}
+
+				continue;
+			}
+
+			auto limit_at = std::chrono::steady_clock::time_point::max();
+
+			for (const Running& test : running) {
+				limit_at = std::min(limit_at, test.deadline);
+			}
+
+			scheduler.wait(limit_at);
+
+			// destroy the tests that ran out of time, their coroutines are all suspended so that is safe
+			const auto now = std::chrono::steady_clock::now();
+
+			for (auto it = running.begin(); it != running.end();) {
+				auto current = it ++;
+
+				if (current->deadline <= now) {
+					settle(current, false, "Error: Timed out after " + std::to_string(timeout_of(current->index)) + "ms!");
+				}
+			}
+		}
+
+		vstl::loop = nullptr;
+		vstl::worker = nullptr;
+	}
+
+	#ifndef _WIN32
+	/// header of a single message sent by a child process, followed by [length] bytes of text,
+	/// for results the first [split] bytes of it are the error and the rest is the note
+	struct Record {
+		uint32_t index;
+		uint32_t status;
+		uint32_t length;
+		uint32_t split;
+		uint32_t output;
+		uint32_t attempts;
+		double elapsed;
+	};
+
+	enum RecordStatus : uint32_t {
+		VSTL_RECORD_STARTED,
+		VSTL_RECORD_SUCCESSFUL,
+		VSTL_RECORD_FAILED,
+		VSTL_RECORD_BASELINE
+	};
+
+	/// one forked worker process of the isolated runner, along with the tests it still has to report
+	struct Child {
+		pid_t pid = -1;
+		int fd = -1;
+
+		// file the child captures the output of its tests into, -1 if the output isn't captured
+		int output = -1;
+		bool started = false;
+		bool killed = false;
+		bool expired = false;
+		std::chrono::steady_clock::time_point since;
+		std::deque<size_t> batch;
+		std::string buffer;
+	};
+
+	/// writes the whole buffer to the given file descriptor, retrying on partial writes
+	inline bool write_all(int fd, const void* data, size_t size) {
+		const char* bytes = (const char*) data;
+
+		while (size > 0) {
+			ssize_t written = write(fd, bytes, size);
+
+			if (written < 0 && errno == EINTR) {
+				continue;
+			}
+
+			if (written <= 0) {
+				return false;
+			}
+
+			bytes += written;
+			size -= written;
+		}
+
+		return true;
+	}
+
+	/// sends a single record from the child process to the runner
+	inline void send_record(int fd, size_t index, RecordStatus status, const std::string& text, size_t split = 0, size_t output = 0, double elapsed = 0, size_t attempts = 1) {
+		Record record {(uint32_t) index, status, (uint32_t) text.size(), (uint32_t) split, (uint32_t) output, (uint32_t) attempts, elapsed};
+		write_all(fd, &record, sizeof(Record));
+		write_all(fd, text.data(), text.size());
+	}
+
+	/// reporter of a forked child process, forwards all events to the runner over a pipe
+	struct PipeReporter final : public Reporter {
+
+		int fd;
+
+		PipeReporter(int fd)
+		: fd(fd) {}
+
+		void start(const char* name) override {
+			send_record(fd, vstl::worker->test_id, VSTL_RECORD_STARTED, "");
+		}
+
+		void send(const Result& result) {
+
+			// hand the benchmark results to the runner first, it owns the baseline file
+			for (const auto& [name, baseline] : recorded) {
+				send_record(fd, vstl::worker->test_id, VSTL_RECORD_BASELINE, format_baseline(name, baseline));
+			}
+
+			recorded.clear();
+			send_record(fd, vstl::worker->test_id, result.passed ? VSTL_RECORD_SUCCESSFUL : VSTL_RECORD_FAILED, result.error + result.note + result.output, result.error.size(), result.error.size() + result.note.size(), result.millis, result.attempts);
+		}
+
+		void pass(const Result& result) override {
+			send(result);
+		}
+
+		void fail(const Result& result) override {
+			send(result);
+		}
+
+	};
+
+	/// body of the forked child process, runs the batch and reports each result back over [fd]
+	[[noreturn]] inline void child_main(int fd, int output, const std::deque<size_t>& batch) {
+
+		// let faults kill the child, the runner will report them
+		signal(SIGSEGV, SIG_DFL);
+
+		Worker local;
+		PipeReporter pipe {fd};
+
+		vstl::worker = &local;
+		vstl::reporters = {&pipe};
+
+		// the runner draws the timeline of the children itself
+		tracing = false;
+
+		// a file makes stdout fully buffered, and whatever a crashing test printed last would never reach it
+		if (output != -1) {
+			redirect = {output, dup(STDOUT_FILENO), dup(STDERR_FILENO)};
+			setvbuf(stdout, nullptr, _IONBF, 0);
+			std::cout << std::unitbuf;
+		}
+
+		for (size_t index : batch) {
+			begin(local, index);
+			tests[index]->run();
+		}
+
+		// fixtures can't be shared with the other processes, so each child tears down its own
+		release_fixtures();
+
+		std::cout.flush();
+		fflush(stdout);
+		close(fd);
+		_exit(0);
+	}
+
+	/// forks a new child for the given batch of tests, returns false if the process could not be created
+	inline bool spawn(std::vector<Child>& children, std::deque<size_t>& batch) {
+		int pipes[2];
+
+		if (pipe(pipes) == -1) {
+			return false;
+		}
+
+		// the capture file is shared with the child, it is deleted once both of them close it
+		FILE* file = settings.capture ? tmpfile() : nullptr;
+		const int output = file ? dup(fileno(file)) : -1;
+
+		if (file) {
+			fclose(file);
+		}
+
+		// don't let the child inherit (and later flush) anything buffered by stdio
+		std::cout.flush();
+		fflush(stdout);
+
+		pid_t pid = fork();
+
+		if (pid == -1) {
+			close(pipes[0]);
+			close(pipes[1]);
+
+			if (output != -1) {
+				close(output);
+			}
+
+			return false;
+		}
+
+		if (pid == 0) {
+			close(pipes[0]);
+
+			for (const Child& other : children) {
+				close(other.fd);
+
+				if (other.output != -1) {
+					close(other.output);
+				}
+			}
+
+			child_main(pipes[1], output, batch);
+		}
+
+		close(pipes[1]);
+
+		Child& child = children.emplace_back();
+		child.pid = pid;
+		child.fd = pipes[0];
+		child.output = output;
+		child.batch = std::move(batch);
+		return true;
+	}
+
+	/// parses all complete records the child has sent so far
+	inline void receive(TestMode mode, Worker& local, Child& child) {
+		while (child.buffer.size() >= sizeof(Record)) {
+			Record record;
+			memcpy(&record, child.buffer.data(), sizeof(Record));
+
+			if (child.buffer.size() < sizeof(Record) + record.length) {
+				return;
+			}
+
+			std::string text = child.buffer.substr(sizeof(Record), record.length);
+			child.buffer.erase(0, sizeof(Record) + record.length);
+
+			if (record.status == VSTL_RECORD_BASELINE) {
+				std::stringstream line {text};
+				std::string name;
+				Baseline baseline;
+
+				if (parse_baseline(line, name, baseline)) {
+					recorded[name] = baseline;
+				}
+
+				continue;
+			}
+
+			if (record.status == VSTL_RECORD_STARTED) {
+				child.started = true;
+				child.since = std::chrono::steady_clock::now();
+				report_start(tests[record.index]->name);
+				continue;
+			}
+
+			const bool passed = record.status == VSTL_RECORD_SUCCESSFUL;
+			const bool quarantined = !passed && in_quarantine[record.index];
+
+			durations[record.index] = record.elapsed;
+
+			if (tracing) {
+				trace("test", tests[record.index]->name, child.since.time_since_epoch().count(), passed, child.pid);
+			}
+
+			const std::string error = text.substr(0, record.split);
+			const std::string note = text.substr(record.split, record.output - record.split);
+
+			report({tests[record.index]->name, passed, error, note, record.elapsed, record.attempts, quarantined, text.substr(record.output)});
+			child.started = false;
+			child.batch.pop_front();
+
+			if (!tally(local, record.index, passed, record.attempts) && mode == VSTL_MODE_STRICT) {
+				stop = true;
+			}
+		}
+	}
+
+	/// collects the exit status of a finished child, and reports the test it was running if it died
+	inline void reap(TestMode mode, Worker& local, Child& child, std::deque<size_t>& queue) {
+		int status = 0;
+		close(child.fd);
+		waitpid(child.pid, &status, 0);
+
+		// whatever the dead child has left in its capture file belongs to the test it was running
+		const std::string output = child.output != -1 && child.started ? read_capture(child.output) : "";
+
+		if (child.output != -1) {
+			close(child.output);
+		}
+
+		if (child.batch.empty()) {
+			return;
+		}
+
+		// the child was killed because the run was stopped, the test it was running is cancelled with it
+		if (child.killed) {
+			if (child.started) {
+				const size_t index = child.batch.front();
+
+				if (tracing) {
+					trace("test", tests[index]->name, child.since.time_since_epoch().count(), false, child.pid);
+				}
+
+				report({tests[index]->name, false, "Error: Cancelled, the run was stopped by an earlier failure!", "", millis_since(child.since), 1, false, output, true});
+				tally(local, index, false, 1, true);
+			}
+
+			return;
+		}
+
+		if (child.expired) {
+			queue.insert(queue.begin(), child.batch.begin(), child.batch.end());
+			return;
+		}
+
+		std::stringstream error;
+		error << "Error: ";
+
+		if (WIFSIGNALED(status)) {
+			error << "Worker process terminated by signal " << WTERMSIG(status) << " (" << strsignal(WTERMSIG(status)) << ")!";
+		} else {
+			error << "Worker process exited with code " << WEXITSTATUS(status) << "!";
+		}
+
+		const double elapsed = millis_since(child.since);
+		const size_t index = child.batch.front();
+
+		report_failure(index, error.str(), elapsed, output);
+		durations[index] = elapsed;
+
+		if (tracing) {
+			trace("test", tests[index]->name, child.since.time_since_epoch().count(), false, child.pid);
+		}
+
+		child.batch.pop_front();
+
+		if (!tally(local, index, false) && mode == VSTL_MODE_STRICT) {
+			stop = true;
+		}
+
+		// give the rest of the batch to a fresh child, keeping the original order
+		queue.insert(queue.begin(), child.batch.begin(), child.batch.end());
+	}
+
+	/// kills a child whose test ran past its timeout, the rest of its batch is given to a fresh child once it is reaped
+	inline void expire(TestMode mode, Worker& local, Child& child) {
+		const size_t index = child.batch.front();
+		const double elapsed = millis_since(child.since);
+		std::stringstream error;
+
+		kill(child.pid, SIGKILL);
+		error << "Error: Timed out after " << timeout_of(index) << "ms!";
+
+		report_failure(index, error.str(), elapsed, child.output != -1 ? read_capture(child.output) : "");
+		durations[index] = elapsed;
+
+		if (tracing) {
+			trace("test", tests[index]->name, child.since.time_since_epoch().count(), false, child.pid);
+		}
+
+		child.batch.pop_front();
+		child.expired = true;
+
+		if (!tally(local, index, false) && mode == VSTL_MODE_STRICT) {
+			stop = true;
+		}
+	}
+
+	/// process isolated runner, keeps up to [jobs] children alive with [size] tests each
+	inline void isolated(TestMode mode, Worker& local, const std::vector<size_t>& selected, size_t jobs, size_t size) {
+		std::deque<size_t> queue {selected.begin(), selected.end()};
+		std::vector<Child> children;
+
+		while (true) {
+			while (!stop && !queue.empty() && children.size() < jobs) {
+				std::deque<size_t> batch;
+
+				while (!queue.empty() && batch.size() < size) {
+					batch.push_back(queue.front());
+					queue.pop_front();
+				}
+
+				if (!spawn(children, batch)) {
+					for (size_t index : batch) {
+						report_failure(index, "Error: Failed to fork worker process!", 0);
+						stop = stop || (!tally(local, index, false) && mode == VSTL_MODE_STRICT);
+					}
+				}
+			}
+
+			if (children.empty()) {
+				break;
+			}
+
+			std::vector<pollfd> fds;
+			int wait = -1;
+
+			for (Child& child : children) {
+				fds.push_back({child.fd, POLLIN, 0});
+
+				if (!child.started || child.expired || timeout_of(child.batch.front()) <= 0) {
+					continue;
+				}
+
+				// sleep no longer than until the nearest deadline
+				const double left = timeout_of(child.batch.front()) - millis_since(child.since);
+
+				if (left <= 0) {
+					expire(mode, local, child);
+					continue;
+				}
+
+				wait = std::min((unsigned) wait, (unsigned) std::ceil(left));
+			}
+
+			if (poll(fds.data(), fds.size(), wait) == -1) {
+				continue;
+			}
+
+			for (size_t i = children.size(); i --> 0;) {
+				Child& child = children[i];
+
+				if (fds[i].revents == 0) {
+					continue;
+				}
+
+				char chunk[4096];
+				ssize_t count = read(child.fd, chunk, sizeof(chunk));
+
+				if (count < 0 && errno == EINTR) {
+					continue;
+				}
+
+				// anything a killed child managed to send is stale by now
+				if (count > 0 && child.expired) {
+					continue;
+				}
+
+				if (count > 0) {
+					child.buffer.append(chunk, count);
+					receive(mode, local, child);
+					continue;
+				}
+
+				reap(mode, local, child, queue);
+				children.erase(children.begin() + i);
+			}
+
+			// in strict mode there is no point waiting for the other children
+			if (stop) {
+				for (Child& child : children) {
+					child.killed = true;
+					kill(child.pid, SIGKILL);
+				}
+			}
+		}
+	}
+	#endif
+
+	/// applies the environment variables on top of the given config
+	inline void configure(Config& config) {
+		config.jobs = env_size("VSTL_JOBS", config.jobs);
+		config.isolate = env_size("VSTL_ISOLATE", config.isolate);
+		config.shard_index = env_size("VSTL_SHARD_INDEX", config.shard_index);
+		config.shard_count = env_size("VSTL_SHARD_COUNT", config.shard_count);
+		config.timings = env_string("VSTL_TIMINGS", config.timings);
+		config.bench_time = env_size("VSTL_BENCH_TIME", config.bench_time);
+		config.bench_samples = env_size("VSTL_BENCH_SAMPLES", config.bench_samples);
+		config.bench_baseline = env_string("VSTL_BENCH_BASELINE", config.bench_baseline);
+		config.bench_threshold = env_size("VSTL_BENCH_THRESHOLD", config.bench_threshold);
+		config.bench_update = env_size("VSTL_BENCH_UPDATE", config.bench_update);
+		config.slowest = env_size("VSTL_SLOWEST", config.slowest);
+		config.time_budget = env_size("VSTL_TIME_BUDGET", config.time_budget);
+		config.timeout = env_size("VSTL_TIMEOUT", config.timeout);
+		config.junit = env_string("VSTL_JUNIT", config.junit);
+		config.json = env_string("VSTL_JSON", config.json);
+		config.state = env_string("VSTL_STATE", config.state);
+		config.trace = env_string("VSTL_TRACE", config.trace);
+		config.failed_first = env_size("VSTL_FAILED_FIRST", config.failed_first);
+		config.fail_fast = env_size("VSTL_FAIL_FAST", config.fail_fast);
+		config.snapshot_update = env_size("VSTL_SNAPSHOT_UPDATE", config.snapshot_update);
+		config.counters = env_size("VSTL_COUNTERS", config.counters);
+		config.resources = env_size("VSTL_RESOURCES", config.resources);
+		config.async_jobs = env_size("VSTL_ASYNC_JOBS", config.async_jobs);
+		config.batch = env_size("VSTL_BATCH", config.batch);
+		config.property_cases = env_size("VSTL_PROPERTY_CASES", config.property_cases);
+		config.seed = env_size("VSTL_SEED", config.seed);
+		config.corpus = env_string("VSTL_CORPUS", config.corpus);
+		config.stress_yield = env_size("VSTL_STRESS_YIELD", config.stress_yield);
+		config.retries = env_size("VSTL_RETRIES", config.retries);
+		config.capture = env_size("VSTL_CAPTURE", config.capture);
+		add_patterns(config.quarantine, env_string("VSTL_QUARANTINE", VSTL_QUARANTINE));
+		add_patterns(config.filters, env_string("VSTL_FILTER", ""));
+	}
+
+	/// applies the command line options on top of the given config, returns false on invalid input
+	inline bool configure(std::ostream& out, Config& config, int argc, char** argv) {
+		for (int i = 1; i < argc; i ++) {
+			std::string arg = argv[i];
+
+			if (arg == "--list") {
+				config.list = true;
+				continue;
+			}
+
+			if (arg == "--help") {
+				config.help = true;
+				continue;
+			}
+
+			if (arg == "--failed-first") {
+				config.failed_first = true;
+				continue;
+			}
+
+			if (arg == "--fail-fast") {
+				config.fail_fast = true;
+				continue;
+			}
+
+			if (arg == "--resources") {
+				config.resources = true;
+				continue;
+			}
+
+			if (arg == "--counters") {
+				config.counters = true;
+				continue;
+			}
+
+			if (arg == "--capture") {
+				config.capture = true;
+				continue;
+			}
+
+			if (arg == "--update-snapshots") {
+				config.snapshot_update = true;
+				continue;
+			}
+
+			if (arg.starts_with("--filter=")) {
+				add_patterns(config.filters, arg.substr(9));
+				continue;
+			}
+
+			if (arg.starts_with("--quarantine=")) {
+				add_patterns(config.quarantine, arg.substr(13));
+				continue;
+			}
+
+			if (arg.starts_with("--retries=") && sscanf(arg.c_str(), "--retries=%zu", &config.retries) == 1) {
+				continue;
+			}
+
+			if (arg.starts_with("--trace=")) {
+				config.trace = arg.substr(8);
+				continue;
+			}
+
+			if (arg.starts_with("--corpus=")) {
+				config.corpus = arg.substr(9);
+				continue;
+			}
+
+			if (arg.starts_with("--shard=") && sscanf(arg.c_str(), "--shard=%zu/%zu", &config.shard_index, &config.shard_count) == 2) {
+				continue;
+			}
+
+			if (arg.starts_with("--repeat=") && sscanf(arg.c_str(), "--repeat=%zu", &config.repeat) == 1) {
+				continue;
+			}
+
+			if (arg.starts_with("--stress-yield=") && sscanf(arg.c_str(), "--stress-yield=%zu", &config.stress_yield) == 1) {
+				continue;
+			}
+
+			if (arg.starts_with("--seed=") && sscanf(arg.c_str(), "--seed=%" SCNu64, &config.seed) == 1) {
+				continue;
+			}
+
+			if (arg.starts_with("--async-jobs=") && sscanf(arg.c_str(), "--async-jobs=%zu", &config.async_jobs) == 1) {
+				continue;
+			}
+
+			if (arg.starts_with("--jobs=") && sscanf(arg.c_str(), "--jobs=%zu", &config.jobs) == 1) {
+				continue;
+			}
+
+			// anything that is not an option is a filter pattern
+			if (!arg.starts_with("--")) {
+				add_patterns(config.filters, arg);
+				continue;
+			}
+
+			out << "ERROR: Invalid option '" << arg << "'! See --help for the supported options";
+			out << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	/// prints the command line options
+	inline void usage(std::ostream& out) {
+		out << "Usage: [options] [patterns...]" << std::endl;
+		out << "  --filter=PATTERNS    only run tests matching any of the comma separated glob patterns," << std::endl;
+		out << "                       patterns starting with '-' exclude the tests they match instead" << std::endl;
+		out << "  --list               print the names of the selected tests and exit" << std::endl;
+		out << "  --repeat=COUNT       run each selected test COUNT times" << std::endl;
+		out << "  --jobs=COUNT         number of worker threads, 0 means one per hardware thread" << std::endl;
+		out << "  --seed=SEED          seed of the inputs generated for property tests, 0 picks a new one" << std::endl;
+		out << "  --corpus=DIR         directory with the inputs replayed by the fuzz tests" << std::endl;
+		out << "  --async-jobs=COUNT   maximum number of async tests running at the same time" << std::endl;
+		out << "  --shard=INDEX/COUNT  only run the given shard of the tests" << std::endl;
+		out << "  --retries=COUNT      run a failed test up to COUNT more times, passing on a retry marks it as flaky" << std::endl;
+		out << "  --quarantine=PATTERNS" << std::endl;
+		out << "                       run the tests matching the comma separated patterns, but ignore their failures" << std::endl;
+		out << "  --failed-first       start with the tests that failed in the last run, requires VSTL_STATE" << std::endl;
+		out << "  --fail-fast          stop on the first failure, like VSTL_MODE_STRICT" << std::endl;
+		out << "  --stress-yield=PCT   percent chance of a STRESS thread yielding between iterations" << std::endl;
+		out << "  --counters           report the hardware performance counters of each test (Linux only)" << std::endl;
+		out << "  --trace=PATH         write the timeline of the run to PATH, in the Chrome trace event format" << std::endl;
+		out << "  --capture            hide the output of the tests, except for those that fail" << std::endl;
+		out << "  --resources          report the memory, page faults and context switches of each test" << std::endl;
+		out << "  --update-snapshots   rewrite the golden files of CHECK_SNAPSHOT instead of comparing them" << std::endl;
+		out << "  --help               print this message and exit" << std::endl;
+	}
+
+	inline int run(std::ostream& out, TestMode mode, Config config) {
+		collect();
+
+		if (config.help) {
+			usage(out);
+			return 0;
+		}
+
+		#ifdef _WIN32
+			signal(SIGSEGV, signal_handler);
+		#else
+			struct sigaction action;
+			action.sa_flags = SA_SIGINFO;
+			sigemptyset(&action.sa_mask);
+			action.sa_sigaction = signal_handler;
+
+			if (sigaction(SIGSEGV, &action, NULL) == -1) {
+				out << "WARN: Failed to setup SIGSEGV handler!";
+				out << std::endl;
+			}
+		#endif
+
+		if (config.shard_count == 0 || config.shard_index >= config.shard_count) {
+			out << "ERROR: Invalid shard " << config.shard_index << "/" << config.shard_count << "!";
+			out << std::endl;
+			return 1;
+		}
+
+		size_t jobs = config.jobs;
+
+		if (config.seed == 0) {
+			config.seed = std::chrono::steady_clock::now().time_since_epoch().count() | 1;
+		}
+
+		vstl::settings = config;
+		expand();
+
+		if (jobs == 0) {
+			jobs = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		expect_timings(config);
+		std::vector<size_t> selected = select(config);
+		in_quarantine.assign(tests.size(), false);
+
+		for (size_t i = 0; i < tests.size(); i ++) {
+			const char* name = tests[i]->parent ? tests[i]->parent->name : tests[i]->name;
+
+			for (const std::string& pattern : config.quarantine) {
+				in_quarantine[i] = in_quarantine[i] || glob(pattern.c_str(), name);
+			}
+		}
+
+		if (!config.bench_baseline.empty() && !config.bench_update) {
+			baselines = load_baselines(config.bench_baseline);
+		}
+
+		if (config.list) {
+			for (size_t index : selected) {
+				out << tests[index]->name << "\n";
+			}
+
+			out.flush();
+			return 0;
+		}
+
+		if (config.repeat != 1) {
+			const std::vector<size_t> once = selected;
+			selected.clear();
+
+			for (size_t i = 0; i < config.repeat; i ++) {
+				selected.insert(selected.end(), once.begin(), once.end());
+			}
+		}
+
+		jobs = std::max((size_t) 1, std::min(jobs, selected.size()));
+		stop = false;
+
+		// with a single worker the order doesn't change the wall time, so keep the declaration order
+		if (jobs > 1) {
+			schedule(selected);
+		}
+
+		if (config.failed_first && config.state.empty()) {
+			out << "WARN: Failed first ordering requires VSTL_STATE to be set!";
+			out << std::endl;
+		}
+
+		if (config.failed_first && !config.state.empty()) {
+			prioritize(selected, load_state(config.state));
+		}
+
+		if (config.fail_fast) {
+			mode = VSTL_MODE_STRICT;
+		}
+
+		// the counters are opened per thread, but if the main one can't have them no other will
+		if (config.counters && !PerfCounters {}.available) {
+			out << "WARN: Hardware performance counters are not available, only the time will be reported!";
+			out << std::endl;
+			config.counters = false;
+			vstl::settings.counters = false;
+		}
+
+		for (FixtureBase* fixture = registered_fixtures.first; fixture != nullptr; fixture = fixture->next) {
+			fixture->users = 0;
+		}
+
+		for (size_t index : selected) {
+			for (FixtureBase* fixture : tests[index]->fixtures) {
+				if (fixture != nullptr) {
+					fixture->users ++;
+				}
+			}
+		}
+
+		ConsoleReporter console {out};
+		std::unique_ptr<FileReporter> junit, json;
+		reporters = {&console};
+
+		if (!config.junit.empty()) {
+			junit = std::make_unique<JUnitReporter>(config.junit);
+			reporters.push_back(junit.get());
+		}
+
+		if (!config.json.empty()) {
+			json = std::make_unique<JsonReporter>(config.json);
+			reporters.push_back(json.get());
+		}
+
+		for (FileReporter* reporter : {junit.get(), json.get()}) {
+			if (reporter != nullptr && !reporter->file) {
+				out << "WARN: Failed to open report file!";
+				out << std::endl;
+			}
+		}
+
+		std::unique_ptr<StateReporter> state;
+
+		if (!config.state.empty()) {
+			state = std::make_unique<StateReporter>(config.state);
+			reporters.push_back(state.get());
+		}
+
+		reporters.insert(reporters.end(), listeners.begin(), listeners.end());
+
+		const auto start = std::chrono::steady_clock::now();
+		tracing = !config.trace.empty();
+
+		// the tests in this process share its descriptors, so only the standard streams can be told apart by thread
+		CaptureBuffer out_buffer {std::cout.rdbuf()}, err_buffer {std::cerr.rdbuf()}, log_buffer {std::clog.rdbuf()};
+		const bool capturing = config.capture && config.isolate == 0;
+
+		if (capturing) {
+			std::cout.rdbuf(&out_buffer);
+			std::cerr.rdbuf(&err_buffer);
+			std::clog.rdbuf(&log_buffer);
+		}
+
+		bool clean = true;
+
+		#ifndef _WIN32
+		if (config.isolate != 0) {
+			Worker local;
+			isolated(mode, local, selected, jobs, config.isolate);
+			merge(local);
+		} else
+		#endif
+		{
+			std::vector<size_t> synchronous, async;
+
+			for (size_t index : selected) {
+				(tests[index]->coroutine ? async : synchronous).push_back(index);
+			}
+
+			// the async tests all share the calling thread, before the rest get the workers
+			if (!async.empty()) {
+				Worker local;
+				asynchronous(mode, local, async, config.async_jobs);
+				merge(local);
+			}
+
+			if (!synchronous.empty()) {
+				clean = threaded(mode, synchronous, std::min(jobs, synchronous.size()));
+			}
+		}
+
+		// tear down the fixtures whose users did not all run, the stuck ones might still be using theirs
+		if (clean) {
+			release_fixtures();
+		}
+
+		if (tracing) {
+			save_trace(config.trace, start.time_since_epoch().count());
+		}
+
+		if (capturing) {
+			std::cout.rdbuf(out_buffer.original);
+			std::cerr.rdbuf(err_buffer.original);
+			std::clog.rdbuf(log_buffer.original);
+		}
+
+		report_summary({vstl::failed, vstl::successful, vstl::flaky, vstl::quarantined, vstl::cancellations, millis_since(start), config});
+		reporters.clear();
+
+		if (!config.timings.empty()) {
+			save_timings(config.timings, config);
+		}
+
+		if (!config.bench_baseline.empty() && config.bench_update) {
+			save_baselines(config.bench_baseline);
+		}
+
+		int code = vstl::failed;
+
+		#ifdef VSTL_RETURN_BOOL
+		code = vstl::failed != 0 ? 1 : 0;
+		#endif
+
+		#ifdef VSTL_RETURN_ZERO
+		code = 0;
+		#endif
+
+		// some tests are still stuck on their threads, exit right away instead of destroying everything they use
+		if (!clean) {
+			out.flush();
+			std::cout.flush();
+			fflush(stdout);
+			std::_Exit(code);
+		}
+
+		return code;
+	}
+
+	inline int run(std::ostream& out, TestMode mode, int argc, char** argv, size_t jobs = VSTL_JOBS) {
+		Config config;
+		config.jobs = jobs;
+		configure(config);
+
+		if (!configure(out, config, argc, argv)) {
+			return 1;
+		}
+
+		return run(out, mode, config);
+	}
+
+	inline int run(std::ostream& out, TestMode mode, size_t jobs = VSTL_JOBS) {
+		return run(out, mode, 0, nullptr, jobs);
+	}
+
+	template<typename S>
+	void fail(const S& message) {
+		throw TestFail {message};
+	}
+
+	/// cuts the running test short because the run is being stopped, it is reported as cancelled instead of failed
+	[[noreturn]] VSTL_COLD inline void cancel() {
+		throw TestCancelled {"Cancelled, the run was stopped by an earlier failure!"};
+	}
+
+	/// becomes true once a failure stops the run (in VSTL_MODE_STRICT or with --fail-fast), from then on no new tests
+	/// are started, and long running tests can check it to return early instead of finishing their work
+	inline bool cancelled() {
+		return stop.load(std::memory_order_relaxed);
+	}
+
+	/// cancels the running test if the run is being stopped, meant to be called often by long tests
+	inline void cancellation_point() {
+		if (cancelled()) [[unlikely]] {
+			cancel();
+		}
+	}
+
+	/// backs the ASSERT_MAX_ALLOCS macro, [before] is the state of the counters at the start of the checked block
+	inline void check_allocs(const Allocations& before, size_t limit, const char* where) {
+		if (!allocation_hooks) [[unlikely]] {
+			throw TestFail {std::string {"Allocation tracking is disabled, define VSTL_ALLOCS as 1 before including vstl.hpp, "} + where};
+		}
+
+		const size_t count = allocations.count - before.count;
+
+		if (count > limit) [[unlikely]] {
+			throw TestFail {"Expected at most " + std::to_string(limit) + " allocations, but there were " + std::to_string(count) + " (" + format_bytes(allocations.bytes - before.bytes) + "), " + where};
+		}
+	}
+
+	/// backs the ASSERT_MAX_RSS macro, [before] is the resource usage at the start of the checked block
+	inline void check_rss(const Resources& before, int64_t limit, const char* where) {
+		const Resources after = sample_resources();
+
+		if (after.rss == 0) [[unlikely]] {
+			throw TestFail {std::string {"The resident set size can't be read on this system, "} + where};
+		}
+
+		const int64_t growth = resident_growth(before, after);
+
+		if (growth > limit) [[unlikely]] {
+			throw TestFail {"Expected the resident set to grow by at most " + format_bytes(limit) + ", but it grew by " + format_bytes(growth) + ", " + where};
+		}
+	}
+
+	/// formats a value for the failure reporter without it knowing the type
+	using Printer = std::string (*)(const void*);
+
+	template <typename T>
+	std::string print_erased(const void* value) {
+		return to_printable(*static_cast<const T*>(value));
+	}
+
+	/// fails the current test with a message fully known at compile time, used by ASSERT
+	[[noreturn]] VSTL_COLD inline void assert_failed(const char* message) {
+		throw TestFail {message};
+	}
+
+	/// builds the message of a failed CHECK, kept out of line so that all the string
+	/// formatting is emitted once instead of at every assertion site
+	[[noreturn]] VSTL_COLD inline void check_failed(Printer printer, const void* a, const void* b, const char* where) {
+		throw TestFail {"Expected " + printer(a) + " to be equal " + printer(b) + ", " + where};
+	}
+
+	/// backs the CHECK macro, [b] is converted to the (decayed) type of [a] before comparing
+	template <typename A, typename B>
+	inline void check(const A a, const B& b, const char* where) {
+		const A expected = (A) b;
+
+		if (a != expected) [[unlikely]] {
+			check_failed(print_erased<A>, &a, &expected, where);
+		}
+	}
+
+	/// elements that are equal exactly when their bytes are, so whole ranges of them can be compared with memcmp
+	template <typename T>
+	concept BitwiseComparable = std::is_scalar_v<T> && std::has_unique_object_representations_v<T>;
+
+	template <typename A, typename B>
+	concept BitwiseComparableRanges = std::ranges::contiguous_range<A> && std::ranges::contiguous_range<B>
+		&& std::same_as<std::ranges::range_value_t<A>, std::ranges::range_value_t<B>>
+		&& BitwiseComparable<std::ranges::range_value_t<A>>;
+
+	/// formats a byte as a two digit hexadecimal number
+	inline std::string format_byte(unsigned char byte) {
+		const char* digits = "0123456789abcdef";
+		return {'0', 'x', digits[byte >> 4], digits[byte & 15]};
+	}
+
+	[[noreturn]] VSTL_COLD inline void range_size_failed(size_t a, size_t b, const char* where) {
+		throw TestFail {"Ranges differ in size: " + std::to_string(a) + " != " + std::to_string(b) + ", " + where};
+	}
+
+	/// walks the whole of both ranges to describe how they differ, [what] is the start of the message
+	template <typename A, typename B, typename P>
+	[[noreturn]] VSTL_COLD void range_failed(const A& a, const B& b, P matches, const std::string& what, const char* where) {
+		size_t index = 0, first = 0, count = 0;
+		std::string values;
+		auto it = std::ranges::begin(b);
+
+		for (const auto& value : a) {
+			if (!matches(value, *it) && count ++ == 0) {
+				first = index;
+				values = to_printable(value) + " != " + to_printable(*it);
+			}
+
+			++ it;
+			++ index;
+		}
+
+		throw TestFail {what + " at " + std::to_string(count) + " of " + std::to_string(index) + " elements, first at index " + std::to_string(first) + ": " + values + ", " + where};
+	}
+
+	/// backs the CHECK_RANGE macro, ranges of integers, enums and pointers are compared with a single memcmp
+	template <typename A, typename B>
+	inline void check_range(const A& a, const B& b, const char* where) {
+		const size_t size = std::ranges::size(a);
+
+		if (size != (size_t) std::ranges::size(b)) [[unlikely]] {
+			range_size_failed(size, std::ranges::size(b), where);
+		}
+
+		bool equal;
+
+		if constexpr (BitwiseComparableRanges<A, B>) {
+			equal = size == 0 || std::memcmp(std::ranges::data(a), std::ranges::data(b), size * sizeof(std::ranges::range_value_t<A>)) == 0;
+		} else {
+			equal = std::equal(std::ranges::begin(a), std::ranges::end(a), std::ranges::begin(b));
+		}
+
+		if (!equal) [[unlikely]] {
+			range_failed(a, b, [] (const auto& x, const auto& y) { return x == y; }, "Ranges differ", where);
+		}
+	}
+
+	/// backs the CHECK_NEAR_RANGE macro, the loop has no early exit so that the compiler can vectorize it
+	template <typename A, typename B, typename T>
+	inline void check_near_range(const A& a, const B& b, T tolerance, const char* where) {
+		const size_t size = std::ranges::size(a);
+
+		if (size != (size_t) std::ranges::size(b)) [[unlikely]] {
+			range_size_failed(size, std::ranges::size(b), where);
+		}
+
+		// written without abs() so that it also works for unsigned elements
+		const auto near = [tolerance] (const auto& x, const auto& y) {
+			return (x > y ? x - y : y - x) <= tolerance;
+		};
+
+		bool equal = true;
+		auto it = std::ranges::begin(b);
+
+		for (const auto& value : a) {
+			equal &= near(value, *it);
+			++ it;
+		}
+
+		if (!equal) [[unlikely]] {
+			range_failed(a, b, near, "Ranges differ by more than " + to_printable(tolerance), where);
+		}
+	}
+
+	[[noreturn]] VSTL_COLD inline void bytes_failed(const unsigned char* a, const unsigned char* b, size_t size, const char* where) {
+		size_t first = 0, count = 0;
+
+		for (size_t i = 0; i < size; i ++) {
+			if (a[i] != b[i] && count ++ == 0) {
+				first = i;
+			}
+		}
+
+		throw TestFail {"Buffers differ at " + std::to_string(count) + " of " + std::to_string(size) + " bytes, first at offset " + std::to_string(first) + ": " + format_byte(a[first]) + " != " + format_byte(b[first]) + ", " + where};
+	}
+
+	/// read only view of a whole file, memory mapped where possible so that it is never copied
+	struct MappedFile {
+		const char* data = nullptr;
+		size_t size = 0;
+		bool exists = false;
+
+		#ifdef _WIN32
+			std::string contents;
+		#endif
+
+		explicit MappedFile(const std::string& path) {
+			#ifdef _WIN32
+				std::ifstream file {path, std::ios::binary};
+
+				if (file) {
+					contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+					data = contents.data();
+					size = contents.size();
+					exists = true;
+				}
+			#else
+				const int fd = open(path.c_str(), O_RDONLY);
+
+				if (fd == -1) {
+					return;
+				}
+
+				struct stat info;
+				exists = fstat(fd, &info) == 0;
+				size = exists ? info.st_size : 0;
+
+				// mapping an empty file fails, but there also is nothing to compare
+				if (size > 0) {
+					void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+					exists = address != MAP_FAILED;
+					data = exists ? static_cast<const char*>(address) : nullptr;
+					size = exists ? size : 0;
+				}
+
+				close(fd);
+			#endif
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator =(const MappedFile&) = delete;
+
+		~MappedFile() {
+			#ifndef _WIN32
+				if (data != nullptr) {
+					munmap(const_cast<char*>(data), size);
+				}
+			#endif
+		}
+
+		std::string_view view() const {
+			return {data, size};
+		}
+	};
+
+	/// returns the part of the line of [text] around [offset], at most [limit] characters long, quoted and escaped
+	inline std::string excerpt(std::string_view text, size_t offset, size_t limit = 64) {
+		offset = std::min(offset, text.size());
+
+		const size_t newline = offset == 0 ? std::string_view::npos : text.rfind('\n', offset - 1);
+		size_t start = newline == std::string_view::npos ? 0 : newline + 1;
+		size_t end = std::min(text.find('\n', offset), text.size());
+
+		if (end - start > limit) {
+			start = offset > start + limit / 2 ? offset - limit / 2 : start;
+			end = std::min(end, start + limit);
+		}
+
+		return "\"" + escape_json(std::string {text.substr(start, end - start)}) + "\"";
+	}
+
+	[[noreturn]] VSTL_COLD inline void snapshot_failed(const std::string& path, std::string_view expected, std::string_view actual, const char* where) {
+		const size_t size = std::min(expected.size(), actual.size());
+		size_t offset = 0;
+
+		while (offset < size && expected[offset] == actual[offset]) {
+			offset ++;
+		}
+
+		const size_t line = std::count(expected.begin(), expected.begin() + offset, '\n') + 1;
+		std::string message = "Snapshot '" + path + "' differs at offset " + std::to_string(offset) + " (line " + std::to_string(line) + ")";
+
+		if (expected.size() != actual.size()) {
+			message += ", sizes " + std::to_string(expected.size()) + " != " + std::to_string(actual.size());
+		}
+
+		throw TestFail {message + ", expected " + excerpt(expected, offset) + " but got " + excerpt(actual, offset) + ", " + where};
+	}
+
+	/// backs the CHECK_SNAPSHOT macro
+	inline void check_snapshot(const std::string& path, std::string_view actual, const char* where) {
+		{
+			const MappedFile golden {path};
+
+			if (golden.exists && golden.view() == actual) {
+				return;
+			}
+
+			if (!settings.snapshot_update) {
+				if (!golden.exists) {
+					vstl::fail("Snapshot '" + path + "' does not exist, run with --update-snapshots to create it, " + where);
+				}
+
+				snapshot_failed(path, golden.view(), actual, where);
+			}
+		}
+
+		// the mapping must be gone before the file is truncated
+		std::ofstream file {path, std::ios::binary | std::ios::trunc};
+
+		if (!file.write(actual.data(), actual.size())) {
+			vstl::fail("Failed to update snapshot '" + path + "', " + where);
+		}
+
+		// threads started by the test (like the ones of STRESS) have no worker to take the note
+		if (vstl::worker != nullptr) {
+			std::string& note = vstl::worker->note;
+			note += (note.empty() ? "" : ", ") + ("updated snapshot '" + path + "'");
+		}
+	}
+
+	template <std::ranges::contiguous_range R> requires (!std::convertible_to<const R&, std::string_view>)
+	inline void check_snapshot(const std::string& path, const R& data, const char* where) {
+		const char* bytes = reinterpret_cast<const char*>(std::ranges::data(data));
+		check_snapshot(path, std::string_view {bytes, std::ranges::size(data) * sizeof(std::ranges::range_value_t<R>)}, where);
+	}
+
+	/// backs the CHECK_BYTES macro
+	inline void check_bytes(const void* a, const void* b, size_t size, const char* where) {
+		if (size != 0 && std::memcmp(a, b, size) != 0) [[unlikely]] {
+			bytes_failed(static_cast<const unsigned char*>(a), static_cast<const unsigned char*>(b), size, where);
+		}
+	}
+
+	/// prevents the compiler from optimizing away the computation of the given [value]
+	template <typename T>
+	inline void do_not_optimize(const T& value) {
+		#if defined(__GNUC__) || defined(__clang__)
+			if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void*)) {
+				asm volatile("" : : "r,m"(value) : "memory");
+			} else {
+				asm volatile("" : : "m"(value) : "memory");
+			}
+		#else
+			static const volatile void* sink;
+			sink = &value;
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+		#endif
+	}
+
+	/// prevents the compiler from optimizing away the computation of the given [value], or assuming anything about it later
+	template <typename T>
+	inline void do_not_optimize(T& value) {
+		#if defined(__GNUC__) || defined(__clang__)
+			if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void*)) {
+				asm volatile("" : "+r,m"(value) : : "memory");
+			} else {
+				asm volatile("" : "+m"(value) : : "memory");
+			}
+		#else
+			static volatile void* sink;
+			sink = &value;
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+		#endif
+	}
+
+	/// forces all pending memory writes to be treated as visible, so they can't be optimized away
+	inline void clobber_memory() {
+		#if defined(__GNUC__) || defined(__clang__)
+			asm volatile("" : : : "memory");
+		#else
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+		#endif
+	}
+
+	/// name and shape of a stress test, combined with its body into a test by the STRESS macro
+	template <size_t Threads, size_t Iterations>
+	struct Stress {
+		Spec spec;
+	};
+
+	inline thread_local size_t stress_thread = 0;
+	inline thread_local uint64_t stress_random = 0;
+
+	/// index of the STRESS thread calling this function, from 0 to the number of threads - 1
+	inline size_t stress_index() {
+		return stress_thread;
+	}
+
+	/// yields the calling thread with the probability set by VSTL_STRESS_YIELD, call it from a STRESS
+	/// block between the steps that should be interleaved differently on each run
+	inline void stress_yield() {
+		if (settings.stress_yield == 0) {
+			return;
+		}
+
+		// xorshift64, seeded by the thread index and the time the thread started
+		uint64_t& x = stress_random;
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+
+		if (x % 100 < settings.stress_yield) {
+			std::this_thread::yield();
+		}
+	}
+
+	/// runs [body] the given number of [iterations] on each of the [threads], reports the first failure along with its thread,
+	/// a fault on one of those threads can't be recovered from and ends the run, unless the tests are isolated
+	template <typename F>
+	void stress(F& body, size_t threads, size_t iterations) {
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		std::atomic<size_t> ready = 0, target = threads, failures = 0;
+		std::atomic<size_t> first = threads;
+		std::vector<std::exception_ptr> errors(threads);
+		std::vector<std::thread> pool;
+
+		const auto contender = [&] (size_t index) {
+			stress_thread = index;
+			stress_random = ((uint64_t) std::chrono::steady_clock::now().time_since_epoch().count() * 0x9e3779b97f4a7c15 + index) | 1;
+
+			// spin until every thread is ready, so that they really start together
+			ready ++;
+
+			while (ready.load() < target.load()) {
+				std::this_thread::yield();
+			}
+
+			try {
+				for (size_t i = 0; i < iterations && failures.load(std::memory_order_relaxed) == 0 && !cancelled(); i ++) {
+					body();
+					stress_yield();
+				}
+			} catch (...) {
+				errors[index] = std::current_exception();
+				size_t none = threads;
+				first.compare_exchange_strong(none, index);
+				failures ++;
+			}
+		};
+
+		try {
+			for (size_t i = 0; i < threads; i ++) {
+				pool.emplace_back(contender, i);
+			}
+		} catch (...) {
+			// let the threads that did start finish, then report the reason
+			target = pool.size();
+
+			for (std::thread& thread : pool) {
+				thread.join();
+			}
+
+			throw;
+		}
+
+		for (std::thread& thread : pool) {
+			thread.join();
+		}
+
+		if (failures == 0) {
+			cancellation_point();
+			return;
+		}
+
+		try {
+			std::rethrow_exception(errors[first]);
+		} catch (TestFail& fail) {
+			throw TestFail {"Thread " + std::to_string(first) + " of " + std::to_string(threads) + " (" + std::to_string(failures) + " failed): " + fail.what()};
+		}
+	}
+
+	/// cases of a parameterized test, built once per process by the [Maker] given to TEST_P
+	template <typename M>
+	const auto& cases_of() {
+		static const auto cases = M {}();
+		return cases;
+	}
+
+	/// splitmix64, gives well mixed pseudo random numbers even for consecutive states
+	inline uint64_t next_random(uint64_t& state) {
+		uint64_t z = (state += 0x9e3779b97f4a7c15);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+		return z ^ (z >> 31);
+	}
+
+	/// generates arbitrary values of [T] for property tests, and simpler variants of the failing ones
+	template <typename T>
+	struct Arbitrary;
+
+	template <typename T> requires std::is_integral_v<T> && (!std::same_as<T, bool>)
+	struct Arbitrary<T> {
+		using value_type = T;
+
+		T generate(uint64_t& state) const {
+			const uint64_t random = next_random(state);
+
+			// the edge cases are way more likely to break something than any other value
+			switch (random % 16) {
+				case 0: return 0;
+				case 1: return 1;
+				case 2: return std::numeric_limits<T>::max();
+				case 3: return std::numeric_limits<T>::min();
+				case 4: return (T) -1;
+				case 5: case 6: case 7: return (T) (next_random(state) % 201) - (std::is_signed_v<T> ? 100 : 0);
+				default: return (T) next_random(state);
+			}
+		}
+
+		std::vector<T> shrink(const T& value) const {
+			std::vector<T> simpler;
+
+			if (value != 0) {
+				simpler.push_back(0);
+				simpler.push_back(value / 2);
+				simpler.push_back(value > 0 ? value - 1 : value + 1);
+			}
+
+			return simpler;
+		}
+	};
+
+	template <>
+	struct Arbitrary<bool> {
+		using value_type = bool;
+
+		bool generate(uint64_t& state) const {
+			return next_random(state) & 1;
+		}
+
+		std::vector<bool> shrink(const bool& value) const {
+			return value ? std::vector<bool> {false} : std::vector<bool> {};
+		}
+	};
+
+	template <typename T> requires std::is_floating_point_v<T>
+	struct Arbitrary<T> {
+		using value_type = T;
+
+		T generate(uint64_t& state) const {
+			const uint64_t random = next_random(state);
+
+			switch (random % 16) {
+				case 0: return 0;
+				case 1: return 1;
+				case 2: return -1;
+				case 3: return std::numeric_limits<T>::max();
+				case 4: return std::numeric_limits<T>::lowest();
+				case 5: return std::numeric_limits<T>::min();
+				case 6: return std::numeric_limits<T>::epsilon();
+				default: return (T) ((double) next_random(state) / (double) UINT64_MAX * 2e6 - 1e6);
+			}
+		}
+
+		std::vector<T> shrink(const T& value) const {
+			std::vector<T> simpler;
+
+			if (value != 0 && std::isfinite(value)) {
+				simpler.push_back(0);
+				simpler.push_back(std::trunc(value));
+				simpler.push_back(value / 2);
+			}
+
+			std::erase(simpler, value);
+			return simpler;
+		}
+	};
+
+	/// shrinks a sequence by dropping parts of it, and then by shrinking its elements one by one
+	template <typename S, typename E>
+	std::vector<S> shrink_sequence(const S& value, const E& element) {
+		std::vector<S> simpler;
+		const size_t size = value.size();
+
+		if (size == 0) {
+			return simpler;
+		}
+
+		simpler.push_back(S {});
+
+		if (size > 1) {
+			simpler.push_back(S {value.begin(), value.begin() + size / 2});
+			simpler.push_back(S {value.begin() + size / 2, value.end()});
+		}
+
+		for (size_t i = 0; i < size; i ++) {
+			S shorter = value;
+			shorter.erase(shorter.begin() + i);
+			simpler.push_back(std::move(shorter));
+		}
+
+		for (size_t i = 0; i < size; i ++) {
+			for (auto& replacement : element.shrink(value[i])) {
+				S changed = value;
+				changed[i] = replacement;
+				simpler.push_back(std::move(changed));
+			}
+		}
+
+		return simpler;
+	}
+
+	template <>
+	struct Arbitrary<std::string> {
+		using value_type = std::string;
+
+		struct Char {
+			std::vector<char> shrink(char value) const {
+				return value == 'a' ? std::vector<char> {} : std::vector<char> {'a'};
+			}
+		};
+
+		std::string generate(uint64_t& state) const {
+			std::string value(next_random(state) % 33, ' ');
+
+			// mostly printable ASCII, with a control or non ASCII byte now and then
+			for (char& c : value) {
+				const uint64_t random = next_random(state);
+				c = random % 10 == 0 ? (char) (random >> 8) : (char) (' ' + (random >> 8) % 95);
+			}
+
+			return value;
+		}
+
+		std::vector<std::string> shrink(const std::string& value) const {
+			return shrink_sequence(value, Char {});
+		}
+	};
+
+	template <typename T>
+	struct Arbitrary<std::vector<T>> {
+		using value_type = std::vector<T>;
+
+		Arbitrary<T> element;
+
+		std::vector<T> generate(uint64_t& state) const {
+			std::vector<T> value;
+			const size_t size = next_random(state) % 33;
+
+			for (size_t i = 0; i < size; i ++) {
+				value.push_back(element.generate(state));
+			}
+
+			return value;
+		}
+
+		std::vector<std::vector<T>> shrink(const std::vector<T>& value) const {
+			return shrink_sequence(value, element);
+		}
+	};
+
+	/// generator of the integers in the closed range [low, high], shrinks towards [low]
+	template <typename T>
+	struct Between {
+		using value_type = T;
+
+		T low, high;
+
+		T generate(uint64_t& state) const {
+			const uint64_t span = (uint64_t) high - (uint64_t) low;
+			const uint64_t random = next_random(state);
+			// the offset might not fit into T, the sum wraps around in uint64_t and only the result is converted back
+			return span == UINT64_MAX ? (T) random : (T) ((uint64_t) low + random % (span + 1));
+		}
+
+		std::vector<T> shrink(const T& value) const {
+			std::vector<T> simpler;
+
+			// bisect the distance to [low], the first candidate that still fails halves the distance to the
+			// boundary of the failure, so that it is found in a logarithmic number of steps
+			const uint64_t distance = (uint64_t) value - (uint64_t) low;
+
+			if (distance != 0) {
+				simpler.push_back(low);
+			}
+
+			for (uint64_t step = distance / 2; step > 0; step /= 2) {
+				simpler.push_back((T) ((uint64_t) value - step));
+			}
+
+			return simpler;
+		}
+	};
+
+	/// generator of arbitrary values of [T], for TEST_PROPERTY: TEST_PROPERTY(example_test, vstl::any<int>()) { ... }
+	template <typename T>
+	Arbitrary<T> any() {
+		return {};
+	}
+
+	/// generator of the integers from [low] to [high], both inclusive: TEST_PROPERTY(example_test, vstl::between(1, 6)) { ... }
+	template <typename T> requires std::is_integral_v<T>
+	Between<T> between(T low, T high) {
+		return {low, high};
+	}
+
+	/// the cases of a property test, each one generated from its index, so that they can be produced in any order, on any thread
+	template <typename G>
+	struct Property {
+		G generator;
+
+		size_t size() const {
+			return settings.property_cases;
+		}
+
+		typename G::value_type at(size_t index, uint64_t salt) const {
+			uint64_t state = settings.seed ^ salt;
+			state += index * 0x2545f4914f6cdd1d;
+			next_random(state);
+			return generator.generate(state);
+		}
+	};
+
+	/// runs the test [body] with the given [value], on failure writes the reason into [error] and returns false
+	template <typename F, typename T>
+	bool attempt(F& body, const T& value, std::string& error) {
+		try {
+			body(value);
+			return true;
+		} catch (vstl::TestFail& fail) {
+			error = fail.what();
+		} catch (vstl::TestCancelled&) {
+			throw;
+		} catch (...) {
+			std::stringstream reason;
+			describe_exception(reason);
+			error = reason.str();
+		}
+
+		return false;
+	}
+
+	/// runs the batch of cases of the current test, all of them, and then reports the first failing one along with the number of failures
+	template <typename M, typename F>
+	void run_cases() {
+		const auto& cases = cases_of<M>();
+		const Test& test = *tests[vstl::worker->test_id];
+		const char* family = test.parent ? test.parent->name : test.name;
+
+		F body;
+		size_t failures = 0;
+		std::string message;
+
+		const auto failed = [&] (size_t index, const auto& value, const std::string& error) {
+			if (failures ++ == 0) {
+				message = "Case " + std::to_string(index) + " failed for " + to_printable(value);
+				message += ", " + error;
+			}
+		};
+
+		if constexpr (requires { cases.at((size_t) 0, (uint64_t) 0); }) {
+			const uint64_t salt = hash(family);
+
+			for (size_t i = test.first; i < test.last && !cancelled(); i ++) {
+				const auto value = cases.at(i, salt);
+				std::string error;
+
+				if (attempt(body, value, error)) {
+					continue;
+				}
+
+				if (failures ++ != 0) {
+					continue;
+				}
+
+				// keep taking the first simpler value that still fails, until none does
+				auto simplest = value;
+				size_t steps = 0;
+
+				for (bool shrunk = true; shrunk && steps < 1000;) {
+					shrunk = false;
+
+					for (const auto& candidate : cases.generator.shrink(simplest)) {
+						std::string reason;
+
+						if (!attempt(body, candidate, reason)) {
+							simplest = candidate;
+							error = reason;
+							shrunk = true;
+							steps ++;
+							break;
+						}
+					}
+				}
+
+				message = "Property failed for " + to_printable(simplest);
+
+				if (steps > 0) {
+					message += " (shrunk from " + to_printable(value) + " in " + std::to_string(steps) + " steps)";
+				}
+
+				message += ", case " + std::to_string(i) + " with --seed=" + std::to_string(settings.seed) + ", " + error;
+			}
+		} else {
+			auto it = std::ranges::next(std::ranges::begin(cases), test.first);
+
+			for (size_t i = test.first; i < test.last && !cancelled(); i ++, ++ it) {
+				std::string error;
+
+				if (!attempt(body, *it, error)) {
+					failed(i, *it, error);
+				}
+			}
+		}
+
+		// the cases that did fail are worth more than the news of the cancellation
+		if (failures == 0) {
+			cancellation_point();
+		}
+
+		if (failures > 1) {
+			message += " (" + std::to_string(failures) + " of " + std::to_string(test.last - test.first) + " cases failed)";
+		}
+
+		if (failures > 0) {
+			throw TestFail {message};
+		}
+	}
+
+	/// number of cases of a parameterized test
+	template <typename M>
+	size_t count_cases() {
+		return std::ranges::size(cases_of<M>());
+	}
+
+	/// where the cases come from, combined with the body into a test by the TEST_P and TEST_PROPERTY macros
+	template <typename M>
+	struct Parameterized {
+		Spec spec;
+		M maker;
+	};
+
+	/// name of a fuzz test, combined with its body into a test by the FUZZ macro
+	struct Fuzz {
+		Spec spec;
+	};
+
+	/// runs the fuzz test of the current worker with every input of its corpus, the empty input included
+	inline void replay() {
+		const Test& test = *tests[vstl::worker->test_id];
+		const std::filesystem::path directory = std::filesystem::path {settings.corpus} / test.name;
+
+		std::vector<std::filesystem::path> inputs;
+		std::error_code code;
+
+		for (const auto& entry : std::filesystem::directory_iterator {directory, code}) {
+			if (entry.is_regular_file(code)) {
+				inputs.push_back(entry.path());
+			}
+		}
+
+		// always in the same order, so that the reported (first) failure does not change between runs
+		std::sort(inputs.begin(), inputs.end());
+		inputs.insert(inputs.begin(), std::filesystem::path {});
+
+		size_t failures = 0;
+		std::string message;
+
+		for (const auto& path : inputs) {
+			if (cancelled()) {
+				break;
+			}
+
+			const MappedFile file {path.string()};
+			const std::span<const uint8_t> data {reinterpret_cast<const uint8_t*>(file.data), file.size};
+			std::string error;
+
+			if (!attempt(test.fuzzer, data, error) && failures ++ == 0) {
+				message = path.empty() ? "Empty input failed" : "Input '" + path.string() + "' failed";
+				message += ", " + error;
+			}
+		}
+
+		std::string& note = vstl::worker->note;
+		note += (note.empty() ? "" : ", ") + ("corpus: " + std::to_string(inputs.size() - 1) + " inputs");
+
+		if (failures == 0) {
+			cancellation_point();
+		}
+
+		if (failures > 1) {
+			message += " (" + std::to_string(failures) + " of " + std::to_string(inputs.size()) + " inputs failed)";
+		}
+
+		if (failures > 0) {
+			throw TestFail {message};
+		}
+	}
+
+	/// the fuzz test exposed to libFuzzer, the one named by VSTL_FUZZ, which can be left unset if there is just one
+	inline const Test* fuzz_target() {
+		collect();
+		configure(settings);
+
+		const std::string name = env_string("VSTL_FUZZ", "");
+		std::vector<const Test*> targets;
+
+		for (const Test* test : tests) {
+			if (test->fuzzer != nullptr && (name.empty() || name == test->name)) {
+				targets.push_back(test);
+			}
+		}
+
+		if (targets.size() != 1) {
+			std::cerr << "ERROR: Set VSTL_FUZZ to one of the fuzz tests:";
+
+			for (const Test* test : tests) {
+				if (test->fuzzer != nullptr) {
+					std::cerr << " " << test->name;
+				}
+			}
+
+			std::cerr << std::endl;
+			std::exit(1);
+		}
+
+		return targets.front();
+	}
+
+	/// runs the body of the fuzz target with a single input, any failure becomes a crash so that the fuzzer keeps the input
+	inline int fuzz(const uint8_t* data, size_t size) {
+		static const Test* target = fuzz_target();
+		static thread_local Worker state;
+
+		vstl::worker = &state;
+		state.note.clear();
+
+		try {
+			target->fuzzer({data, size});
+			return 0;
+		} catch (vstl::TestFail& fail) {
+			std::cerr << "Test '" << target->name << "' " << VSTL_FAILED << "! Error: " << fail.what() << std::endl;
+		} catch (...) {
+			std::cerr << "Test '" << target->name << "' " << VSTL_FAILED << "! ";
+			describe_exception(std::cerr);
+			std::cerr << std::endl;
+		}
+
+		std::abort();
+	}
+
+	/// name of an async test, combined with its body into a test by the TEST_ASYNC macro
+	struct Async {
+		Spec spec;
+	};
+
+	/// name of a benchmark, combined with its body into a test by the BENCH macro
+	struct Benchmark {
+		Spec spec;
+	};
+
+	/// statistics of a single benchmark, all durations are in nanoseconds per iteration
+	struct BenchStats {
+		size_t samples = 0, iterations = 0;
+		double min = 0, median = 0, p99 = 0, mean = 0, stddev = 0, mad = 0;
+
+		// hardware counters summed over all the measured (not warmup) iterations, if they were read
+		bool counted = false;
+		CounterValues counters;
+	};
+
+	/// computes statistics of the given per-iteration sample durations
+	inline BenchStats statistics(std::vector<double> samples, size_t iterations) {
+		BenchStats stats;
+		std::sort(samples.begin(), samples.end());
+
+		const size_t count = samples.size();
+		stats.samples = count;
+		stats.iterations = iterations;
+		stats.min = samples.front();
+		stats.median = count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+		stats.p99 = samples[(size_t) std::ceil(count * 0.99) - 1];
+
+		for (double sample : samples) {
+			stats.mean += sample;
+		}
+
+		stats.mean /= count;
+
+		for (double sample : samples) {
+			stats.stddev += (sample - stats.mean) * (sample - stats.mean);
+		}
+
+		stats.stddev = count > 1 ? std::sqrt(stats.stddev / (count - 1)) : 0;
+
+		// median absolute deviation, a measure of noise that ignores the occasional outlier
+		for (double& sample : samples) {
+			sample = std::abs(sample - stats.median);
+		}
+
+		std::sort(samples.begin(), samples.end());
+		stats.mad = count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+		return stats;
+	}
+
+	/// runs [body] the given number of times, returns the total time in nanoseconds
+	template <typename F>
+	double batch(F& body, size_t iterations) {
+		const auto start = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < iterations; i ++) {
+			body();
+		}
+
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// measures the [body], first warming it up and picking the number of iterations per sample so that all samples fit the time budget
+	template <typename F>
+	BenchStats measure(F& body) {
+		size_t samples = std::max((size_t) 1, settings.bench_samples);
+		const double budget = settings.bench_time * 1e6;
+
+		// warmup, doubling the batch size until the warmup took a tenth of the
+		// budget, the last batch then gives a good estimate of a single iteration
+		size_t iterations = 1;
+		double total = 0, last = 0;
+
+		{
+			TraceSpan span {"bench", "warmup"};
+
+			while (true) {
+				last = batch(body, iterations);
+				total += last;
+
+				if (total >= budget / 10 || cancelled()) {
+					break;
+				}
+
+				iterations *= 2;
+			}
+		}
+
+		const double estimate = std::max(last / iterations, 1.0);
+
+		// a body too slow for a single iteration per sample takes fewer samples instead, a few of them
+		// are always taken though, fewer would say nothing about the noise of the measurement
+		const size_t affordable = (size_t) (budget * 0.9 / estimate);
+		samples = std::max(std::min(samples, affordable), std::min(samples, (size_t) 5));
+		iterations = std::max((size_t) 1, (size_t) (budget * 0.9 / samples / estimate));
+
+		std::vector<double> results;
+		results.reserve(samples);
+
+		CounterValues counters, before, after;
+		bool counted = settings.counters && perf_counters().available;
+
+		{
+			TraceSpan span {"bench", "measure"};
+
+			for (size_t i = 0; i < samples && !cancelled(); i ++) {
+				counted = counted && perf_counters().read(before);
+				results.push_back(batch(body, iterations) / iterations);
+				counted = counted && perf_counters().read(after);
+				counters += after - before;
+			}
+		}
+
+		// a partial measurement would be compared against (or saved as) the baseline
+		cancellation_point();
+
+		BenchStats stats = statistics(results, iterations);
+		stats.counted = counted;
+		stats.counters = counters;
+		return stats;
+	}
+
+	/// compares the benchmark results against its baseline, returns the failure reason if the median got
+	/// both slower than the threshold and slower by more than the measurement noise can explain
+	inline std::string compare(const BenchStats& stats, const Baseline& baseline, std::ostream& note) {
+		const double change = (stats.median - baseline.median) / baseline.median * 100;
+
+		// standard error of both medians, estimated from the MAD (1.4826 scales it to a standard deviation
+		// and 1.2533 is the efficiency of the median relative to the mean, for normally distributed samples)
+		const double se_old = 1.2533 * 1.4826 * baseline.mad / std::sqrt(std::max(baseline.samples, (size_t) 1));
+		const double se_new = 1.2533 * 1.4826 * stats.mad / std::sqrt(std::max(stats.samples, (size_t) 1));
+		const double error = std::sqrt(se_old * se_old + se_new * se_new);
+		const double z = error > 0 ? (stats.median - baseline.median) / error : INFINITY;
+
+		note << ", baseline: " << (change >= 0 ? "+" : "") << std::setprecision(3) << change << "%";
+
+		if (change > (double) settings.bench_threshold && z > 3) {
+			std::stringstream error;
+			error << "Median of " << format_nanos(stats.median) << " is " << std::setprecision(3) << change << "% slower than the baseline ";
+			error << format_nanos(baseline.median) << " (threshold: " << settings.bench_threshold << "%, z-score: " << z << ")";
+			return error.str();
+		}
+
+		return "";
+	}
+
+	/// executes a benchmark and attaches its statistics to the result of the current test
+	template <typename F>
+	void benchmark(F& body) {
+		const BenchStats stats = measure(body);
+		const char* name = tests[vstl::worker->test_id]->name;
+		std::stringstream note;
+
+		note << "median: " << format_nanos(stats.median);
+		note << ", min: " << format_nanos(stats.min);
+		note << ", p99: " << format_nanos(stats.p99);
+		note << ", stddev: " << format_nanos(stats.stddev);
+		note << ", iterations: " << stats.samples << "x" << stats.iterations;
+
+		if (stats.counted) {
+			note << ", " << format_counters(stats.counters, stats.samples * stats.iterations);
+			vstl::worker->counted = true;
+		}
+
+		vstl::worker->note = note.str();
+
+		if (settings.bench_update) {
+			std::lock_guard guard {recording};
+			recorded[name] = {stats.median, stats.mad, stats.samples};
+			return;
+		}
+
+		auto it = baselines.find(name);
+
+		if (it != baselines.end() && it->second.median > 0) {
+			const std::string error = compare(stats, it->second, note);
+			vstl::worker->note = note.str();
+
+			if (!error.empty()) {
+				vstl::fail(error);
+			}
+		}
+	}
+
+}
+
+// the returned objects are constructed directly in the variables declared by the macros,
+// so the address each one links into the registry stays valid for the whole program
+
+template <typename F> requires std::convertible_to<F, vstl::Test::Func>
+vstl::Test operator +(const char* name, F tester) {
+    return vstl::Test {name, tester};
+}
+
+inline vstl::Test operator +(const vstl::Spec& spec, vstl::Test::Func tester) {
+    return vstl::Test {spec, tester};
+}
+
+template <typename F>
+vstl::Test operator +(const vstl::Benchmark& bench, F) {
+    return vstl::Test {bench.spec, [] () { F body; vstl::benchmark(body); }};
+}
+
+template <typename M, typename F>
+vstl::Test operator +(const vstl::Parameterized<M>& cases, F) {
+    return vstl::Test {cases.spec, [] () { vstl::run_cases<M, F>(); }, vstl::count_cases<M>};
+}
+
+template <typename F> requires std::convertible_to<F, vstl::Test::Fuzzer>
+vstl::Test operator +(const vstl::Fuzz& fuzz, F) {
+    return vstl::Test {fuzz.spec, vstl::replay, [] (std::span<const uint8_t> data) { F body; body(data); }};
+}
+
+template <typename F> requires std::convertible_to<F, vstl::Test::Coroutine>
+vstl::Test operator +(const vstl::Async& async, F body) {
+    return vstl::Test {async.spec, [] () { F body; vstl::await(body()); }, body};
+}
+
+template <size_t Threads, size_t Iterations, typename F>
+vstl::Test operator +(const vstl::Stress<Threads, Iterations>& stress, F) {
+    return vstl::Test {stress.spec, [] () { F body; vstl::stress(body, Threads, Iterations); }};
+}
+
+template <typename T, typename F> requires std::convertible_to<F, typename vstl::Fixture<T>::Builder>
+vstl::Fixture<T> operator +(const vstl::FixtureOf<T>& fixture, F builder) {
+    return vstl::Fixture<T> {fixture.name, builder};
+}
+
+template <typename T, typename F>
+vstl::Handler operator +(const vstl::HandlerFor<T>&, F) {
+    return vstl::Handler {vstl::handles<T>, [] (std::exception_ptr ptr) {
+        try {
+            std::rethrow_exception(ptr);
+        } catch (const T& error) {
+            F {} (error);
+        }
+    }};
 }
 
-vstl::Handler operator +(const char* name, const vstl::Handler::Func& handler) {
+template <typename F> requires std::convertible_to<F, vstl::Handler::Func>
+vstl::Handler operator +(const char* name, F handler) {
     return vstl::Handler {handler};
 }